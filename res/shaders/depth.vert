@@ -0,0 +1,24 @@
+#version 330
+
+// The start of FrameBlock in main.vert; nothing after it is read here.
+layout(std140) uniform FrameBlock {
+  mat4 projection;
+};
+layout(std140) uniform ObjectBlock {
+  mat4 modelView;
+  vec4 positionScale;
+  vec4 positionOffset;
+  vec4 material;
+};
+
+layout(location = 0) in vec4 position;
+
+// Computed exactly as in main.vert, so the shading pass can test GL_EQUAL
+// against this depth.
+invariant gl_Position;
+
+void main() {
+  vec3 objectPosition = position.xyz * positionScale.xyz + positionOffset.xyz;
+  vec4 relativePosition = modelView * vec4(objectPosition, 1.);
+  gl_Position = projection * relativePosition;
+}
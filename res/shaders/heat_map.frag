@@ -0,0 +1,17 @@
+#version 330
+
+// Fragments shaded per pixel.
+uniform sampler2D overdraw;
+
+out vec4 fragColor;
+
+void main() {
+  float count = texelFetch(overdraw, ivec2(gl_FragCoord.xy), 0).r;
+  // Black where nothing was drawn, then blue for one fragment through green
+  // and yellow to red at eight or more.
+  float heat = clamp((count - 1.) / 7., 0., 1.);
+  vec3 color = heat < .5
+    ? mix(vec3(0., 0., 1.), vec3(0., 1., 0.), heat * 2.)
+    : mix(vec3(1., 1., 0.), vec3(1., 0., 0.), heat * 2. - 1.);
+  fragColor = vec4(count > 0. ? color : vec3(0.), 1.);
+}
@@ -6,10 +6,84 @@ precision highp float;
 precision mediump float;
 #endif
 
+layout(std140) uniform FrameBlock {
+  mat4 projection;
+  // xy: light tiles per pixel; z, w: depth slice scale and bias.
+  vec4 clusterScale;
+  // Tiles in x and y and depth slices.
+  ivec4 clusterCounts;
+  // Texel offsets into the light buffers; w is 0 when there is no light data.
+  ivec4 lightOffsets;
+  // View space, towards the moon.
+  vec4 moonDirection;
+  // View depth at the far end of each shadow cascade.
+  vec4 shadowSplits;
+  // View space to shadow atlas coordinates and depth.
+  mat4 shadowMatrices[4];
+};
+
+uniform sampler2DArray albedoTextures;
+// Two texels per light: view position and radius, then color.
+uniform samplerBuffer lightData;
+// Offset into lightIndices and light count per cluster.
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer lightIndices;
+// Every shadow cascade in one depth texture.
+uniform sampler2DShadow shadowAtlas;
+
 in vec3 vertexColor;
+in vec3 vertexNormal;
+in vec3 viewPosition;
+in vec2 vertexTexCoord;
+flat in float albedoLayer;
 
 out vec4 fragColor;
 
+const vec3 ambientLight = vec3(.06, .07, .1);
+const vec3 moonLight = vec3(.2, .22, .3);
+
+// Fraction of moonlight reaching the fragment. Past the last cascade
+// nothing is shadowed.
+float moonShadow() {
+  float depth = -viewPosition.z;
+  if (depth > shadowSplits.w) {
+    return 1.;
+  }
+  int cascade = int(depth > shadowSplits.x) + int(depth > shadowSplits.y) + int(depth > shadowSplits.z);
+  return texture(shadowAtlas, (shadowMatrices[cascade] * vec4(viewPosition, 1.)).xyz);
+}
+
+// Only the lights binned into this fragment's cluster can reach it.
+vec3 pointLights(vec3 normal) {
+  if (lightOffsets.w == 0) {
+    return vec3(0.);
+  }
+  ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterScale.xy), clusterCounts.xy - 1);
+  int slice = clamp(int(floor(log(-viewPosition.z) * clusterScale.z + clusterScale.w)), 0, clusterCounts.z - 1);
+  int cluster = (slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x;
+  uvec2 range = texelFetch(clusterData, lightOffsets.y + cluster).xy;
+  vec3 light = vec3(0.);
+  for (uint i = 0u; i < range.y; ++i) {
+    int index = int(texelFetch(lightIndices, lightOffsets.z + int(range.x + i)).x);
+    vec4 positionRadius = texelFetch(lightData, lightOffsets.x + index * 2);
+    vec3 color = texelFetch(lightData, lightOffsets.x + index * 2 + 1).rgb;
+    vec3 toLight = positionRadius.xyz - viewPosition;
+    float distanceSquared = max(dot(toLight, toLight), 1e-4);
+    // Inverse square falloff, windowed to reach zero at the radius.
+    float ratio = distanceSquared / (positionRadius.w * positionRadius.w);
+    float window = clamp(1. - ratio * ratio, 0., 1.);
+    float attenuation = window * window / (distanceSquared + 1.);
+    light += color * attenuation * max(dot(normal, toLight * inversesqrt(distanceSquared)), 0.);
+  }
+  return light;
+}
+
 void main() {
-  fragColor = vec4(vertexColor, 1.);
+  vec3 albedo = vertexColor;
+  if (albedoLayer >= 0.) {
+    albedo *= texture(albedoTextures, vec3(vertexTexCoord, albedoLayer)).rgb;
+  }
+  vec3 normal = normalize(gl_FrontFacing ? vertexNormal : -vertexNormal);
+  vec3 light = ambientLight + moonLight * max(dot(normal, moonDirection.xyz), 0.) * moonShadow() + pointLights(normal);
+  fragColor = vec4(albedo * light, 1.);
 }
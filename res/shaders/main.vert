@@ -1,18 +1,61 @@
 #version 330
 
+layout(std140) uniform FrameBlock {
+  mat4 projection;
+  // xy: light tiles per pixel; z, w: depth slice scale and bias.
+  vec4 clusterScale;
+  // Tiles in x and y and depth slices.
+  ivec4 clusterCounts;
+  // Texel offsets into the light buffers; w is 0 when there is no light data.
+  ivec4 lightOffsets;
+  // View space, towards the moon.
+  vec4 moonDirection;
+  // View depth at the far end of each shadow cascade.
+  vec4 shadowSplits;
+  // View space to shadow atlas coordinates and depth.
+  mat4 shadowMatrices[4];
+};
+layout(std140) uniform ObjectBlock {
+  mat4 modelView;
+  // Undoes the per-mesh position quantization.
+  vec4 positionScale;
+  vec4 positionOffset;
+  // x: albedo layer, negative when untextured; y: texture coordinate scale.
+  vec4 material;
+};
+
+// Positions may be 16-bit normalized; w is the bitangent sign as 0 or 1.
+layout(location = 0) in vec4 position;
+// Octahedral unit vectors.
+layout(location = 1) in vec2 normal;
+layout(location = 3) in vec2 texCoord;
+layout(location = 4) in vec4 color;
+
 out vec3 vertexColor;
-const vec2 points[3] = vec2[3](
-  vec2(1., -1.),
-  vec2(-1., -1.),
-  vec2(0., 1.)
-);
-const vec3 colors[3] = vec3[3](
-  vec3(1., 0., 0.),
-  vec3(0., 1., 0.),
-  vec3(0., 0., 1.)
-);
+out vec3 vertexNormal;
+out vec3 viewPosition;
+out vec2 vertexTexCoord;
+flat out float albedoLayer;
+
+// Must match depth.vert for the GL_EQUAL shading pass after a depth
+// pre-pass.
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 encoded) {
+  vec3 vector = vec3(encoded, 1. - abs(encoded.x) - abs(encoded.y));
+  float fold = max(-vector.z, 0.);
+  vector.x += vector.x >= 0. ? -fold : fold;
+  vector.y += vector.y >= 0. ? -fold : fold;
+  return normalize(vector);
+}
 
 void main() {
-  gl_Position = vec4(points[gl_VertexID], 0., 1.);
-  vertexColor = colors[gl_VertexID];
+  vec3 objectPosition = position.xyz * positionScale.xyz + positionOffset.xyz;
+  vec4 relativePosition = modelView * vec4(objectPosition, 1.);
+  gl_Position = projection * relativePosition;
+  viewPosition = relativePosition.xyz;
+  vertexColor = color.rgb;
+  vertexNormal = mat3(modelView) * decodeOctahedral(normal);
+  vertexTexCoord = texCoord * material.y;
+  albedoLayer = material.x;
 }
@@ -0,0 +1,8 @@
+#version 330
+
+out vec4 fragColor;
+
+// Blended additively, so the target ends up holding the fragment count.
+void main() {
+  fragColor = vec4(1.);
+}
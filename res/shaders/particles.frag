@@ -0,0 +1,11 @@
+#version 330
+
+in vec2 corner;
+in vec4 particleColor;
+
+out vec4 fragColor;
+
+void main() {
+  float falloff = max(1. - dot(corner, corner), 0.);
+  fragColor = vec4(particleColor.rgb, particleColor.a * falloff);
+}
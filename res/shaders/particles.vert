@@ -0,0 +1,30 @@
+#version 330
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Per instance.
+layout(location = 0) in vec4 positionAge;
+layout(location = 1) in vec4 velocityLifetime;
+layout(location = 2) in float size;
+layout(location = 3) in uint color;
+
+out vec2 corner;
+out vec4 particleColor;
+
+void main() {
+  corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2. - 1.;
+  if (positionAge.w >= velocityLifetime.w) {
+    // Dead particles collapse outside the clip volume.
+    gl_Position = vec4(2., 2., 2., 1.);
+    particleColor = vec4(0.);
+    return;
+  }
+  vec4 viewPosition = view * vec4(positionAge.xyz, 1.);
+  viewPosition.xy += corner * size;
+  gl_Position = projection * viewPosition;
+  vec4 unpacked = vec4(uvec4(color, color >> 8, color >> 16, color >> 24) & 255u) / 255.;
+  // Fades in quickly and out over the particle's life.
+  float fade = min(positionAge.w * 8., 1.) * (1. - positionAge.w / velocityLifetime.w);
+  particleColor = vec4(unpacked.rgb, unpacked.a * fade);
+}
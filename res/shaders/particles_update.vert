@@ -0,0 +1,92 @@
+#version 330
+
+struct Emitter {
+  // w: size.
+  vec4 position;
+  vec4 extent;
+  // w: velocity jitter.
+  vec4 velocity;
+  vec4 color;
+  // Lifetime and jitter, first particle within the emission and count.
+  vec4 life;
+};
+
+layout(std140) uniform ParticleBlock {
+  Emitter emitters[8];
+  // First slot, slots emitted, capacity and random seed.
+  ivec4 emission;
+  // Camera movement since the last update, and the time step.
+  vec4 step;
+  // Acceleration, and drag per second.
+  vec4 forces;
+};
+
+layout(location = 0) in vec4 positionAge;
+layout(location = 1) in vec4 velocityLifetime;
+layout(location = 2) in float size;
+layout(location = 3) in uint color;
+
+out vec4 nextPositionAge;
+out vec4 nextVelocityLifetime;
+out float nextSize;
+flat out uint nextColor;
+
+uint hash(uint value) {
+  value ^= value >> 16;
+  value *= 0x7feb352du;
+  value ^= value >> 15;
+  value *= 0x846ca68bu;
+  value ^= value >> 16;
+  return value;
+}
+
+float random(inout uint state) {
+  state = hash(state);
+  return float(state >> 8) * (1. / 16777216.);
+}
+
+vec3 randomSigned(inout uint state) {
+  return vec3(random(state), random(state), random(state)) * 2. - 1.;
+}
+
+uint packColor(vec4 value) {
+  uvec4 bytes = uvec4(clamp(value, 0., 1.) * 255. + .5);
+  return bytes.r | (bytes.g << 8) | (bytes.b << 16) | (bytes.a << 24);
+}
+
+void spawn(Emitter emitter) {
+  uint state = hash(uint(gl_VertexID) ^ hash(uint(emission.w)));
+  vec3 direction = randomSigned(state);
+  vec3 velocity = emitter.velocity.xyz + direction * (emitter.velocity.w * random(state) / max(length(direction), 1e-3));
+  float lifetime = max(emitter.life.x + emitter.life.y * (random(state) * 2. - 1.), 1e-2);
+  nextPositionAge = vec4(emitter.position.xyz + randomSigned(state) * emitter.extent.xyz, 0.);
+  nextVelocityLifetime = vec4(velocity, lifetime);
+  nextSize = emitter.position.w;
+  nextColor = packColor(emitter.color);
+}
+
+void main() {
+  // Slots after the emission cursor are the oldest, so they are reused.
+  int emitted = (gl_VertexID - emission.x + emission.z) % emission.z;
+  if (emitted < emission.y) {
+    for (int i = 0; i < 8; ++i) {
+      float first = emitters[i].life.z;
+      if (float(emitted) >= first && float(emitted) < first + emitters[i].life.w) {
+        spawn(emitters[i]);
+        return;
+      }
+    }
+  }
+  nextSize = size;
+  nextColor = color;
+  if (positionAge.w >= velocityLifetime.w) {
+    nextPositionAge = positionAge;
+    nextVelocityLifetime = velocityLifetime;
+    return;
+  }
+  float timeStep = step.w;
+  vec3 velocity = velocityLifetime.xyz + (forces.xyz - velocityLifetime.xyz * forces.w) * timeStep;
+  // Positions are camera-relative, so they move with the camera too.
+  nextPositionAge = vec4(positionAge.xyz + velocity * timeStep - step.xyz, positionAge.w + timeStep);
+  nextVelocityLifetime = vec4(velocity, velocityLifetime.w);
+}
@@ -0,0 +1,27 @@
+#version 330
+
+uniform mat4 boxTransform;
+
+// Unit cube, two triangles per face.
+const vec3 corners[8] = vec3[8](
+  vec3(0., 0., 0.),
+  vec3(1., 0., 0.),
+  vec3(0., 1., 0.),
+  vec3(1., 1., 0.),
+  vec3(0., 0., 1.),
+  vec3(1., 0., 1.),
+  vec3(0., 1., 1.),
+  vec3(1., 1., 1.)
+);
+const int indices[36] = int[36](
+  0, 2, 1, 1, 2, 3,
+  4, 5, 6, 5, 7, 6,
+  0, 1, 4, 1, 5, 4,
+  2, 6, 3, 3, 6, 7,
+  0, 4, 2, 2, 4, 6,
+  1, 3, 5, 3, 7, 5
+);
+
+void main() {
+  gl_Position = boxTransform * vec4(corners[indices[gl_VertexID]], 1.);
+}
@@ -0,0 +1,16 @@
+#version 330
+
+// Same layout as in main.vert; modelView holds the cascade's light
+// projection instead.
+layout(std140) uniform ObjectBlock {
+  mat4 modelView;
+  vec4 positionScale;
+  vec4 positionOffset;
+  vec4 material;
+};
+
+layout(location = 0) in vec4 position;
+
+void main() {
+  gl_Position = modelView * vec4(position.xyz * positionScale.xyz + positionOffset.xyz, 1.);
+}
@@ -0,0 +1,13 @@
+#version 330
+
+uniform sampler2D sceneColor;
+uniform vec4 region;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void main() {
+  // Clamped so bilinear filtering never reaches past the rendered region.
+  fragColor = texture(sceneColor, min(texCoord, region.zw));
+}
@@ -0,0 +1,13 @@
+#version 330
+
+// Scene size over target size in xy, and the last texel centre in zw.
+uniform vec4 region;
+
+out vec2 texCoord;
+
+void main() {
+  // One triangle covering the screen.
+  vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+  texCoord = corner * region.xy;
+  gl_Position = vec4(corner * 2. - 1., 0., 1.);
+}
@@ -0,0 +1,290 @@
+#include "allocation_tracker.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "debug.hxx"
+
+namespace {
+
+// Counters live in fixed tables so that operator new never allocates to
+// record an allocation. Threads past maxThreads share the last slot.
+constexpr int maxThreads{64};
+constexpr int maxCategories{32};
+constexpr int untagged{0};
+
+struct Counters {
+  std::atomic<std::uint64_t> allocations{};
+  std::atomic<std::uint64_t> bytes{};
+  std::atomic<std::uint64_t> deallocations{};
+};
+
+std::array<Counters, maxThreads> threadCounters{};
+std::atomic<int> threadCount{};
+std::array<Counters, maxCategories> categoryCounters{};
+std::array<std::atomic<const char*>, maxCategories> categoryNames{};
+thread_local int threadSlot{-1};
+thread_local int currentCategory{untagged};
+
+// Main thread only.
+std::array<std::uint64_t, maxCategories> frameStartAllocations{};
+std::array<std::uint64_t, maxCategories> frameStartBytes{};
+AllocationCounts lastFrame{};
+std::uint64_t frameCount{};
+std::uint64_t steadyStateFrom{};
+bool steadyStateTest{};
+
+#ifdef TRACK_ALLOCATIONS
+Counters& threadCountersForThisThread() {
+  if (threadSlot < 0) {
+    threadSlot = std::min(threadCount.fetch_add(1, std::memory_order_relaxed), maxThreads - 1);
+  }
+  return threadCounters[threadSlot];
+}
+
+void count(std::size_t size) {
+  Counters& thread{threadCountersForThisThread()};
+  thread.allocations.fetch_add(1, std::memory_order_relaxed);
+  thread.bytes.fetch_add(size, std::memory_order_relaxed);
+  Counters& category{categoryCounters[currentCategory]};
+  category.allocations.fetch_add(1, std::memory_order_relaxed);
+  category.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+// Frees are attributed to the freeing thread only; its current category
+// says nothing about where the memory came from.
+void countDeallocation() {
+  threadCountersForThisThread().deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+  count(size);
+  return std::malloc(size ? size : 1);
+}
+
+// Over-allocates and keeps the malloc pointer just below the aligned block.
+void* allocateAligned(std::size_t size, std::size_t alignment) {
+  count(size);
+  void* base{std::malloc(size + alignment + sizeof(void*))};
+  if (!base) {
+    return nullptr;
+  }
+  const std::uintptr_t start{reinterpret_cast<std::uintptr_t>(base) + sizeof(void*)};
+  void* aligned{reinterpret_cast<void*>((start + alignment - 1) & ~(alignment - 1))};
+  static_cast<void**>(aligned)[-1] = base;
+  return aligned;
+}
+
+void deallocate(void* pointer) {
+  if (pointer) {
+    countDeallocation();
+    std::free(pointer);
+  }
+}
+
+void deallocateAligned(void* pointer) {
+  if (pointer) {
+    countDeallocation();
+    std::free(static_cast<void**>(pointer)[-1]);
+  }
+}
+#endif
+
+const char* categoryName(int category) {
+  const char* name{categoryNames[category].load(std::memory_order_acquire)};
+  return name ? name : "untagged";
+}
+
+} // namespace
+
+#ifdef TRACK_ALLOCATIONS
+void* operator new(std::size_t size) {
+  if (void* pointer{allocate(size)}) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  if (void* pointer{allocateAligned(size, static_cast<std::size_t>(alignment))}) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+  deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+  deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+  deallocateAligned(pointer);
+}
+#endif
+
+AllocationScope::AllocationScope(const char* category) :
+  previous{currentCategory} {
+  // Find the category's slot, claiming a free one on first use.
+  for (int slot{untagged + 1}; slot < maxCategories; ++slot) {
+    const char* expected{nullptr};
+    if (categoryNames[slot].compare_exchange_strong(expected, category, std::memory_order_acq_rel)
+      || expected == category) {
+      currentCategory = slot;
+      return;
+    }
+  }
+  DEBUG_ERROR_LINE("Allocation tracker: no slot left for category " << category);
+}
+
+AllocationScope::~AllocationScope() {
+  currentCategory = previous;
+}
+
+bool allocationTrackingEnabled() {
+#ifdef TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+AllocationCounts threadAllocations() {
+  if (threadSlot < 0) {
+    return AllocationCounts{0, 0};
+  }
+  const Counters& counters{threadCounters[threadSlot]};
+  return AllocationCounts{counters.allocations.load(std::memory_order_relaxed), counters.bytes.load(std::memory_order_relaxed)};
+}
+
+void beginAllocationFrame() {
+  for (int category{}; category < maxCategories; ++category) {
+    frameStartAllocations[category] = categoryCounters[category].allocations.load(std::memory_order_relaxed);
+    frameStartBytes[category] = categoryCounters[category].bytes.load(std::memory_order_relaxed);
+  }
+}
+
+bool endAllocationFrame() {
+  std::array<AllocationCounts, maxCategories> frame{};
+  lastFrame = AllocationCounts{0, 0};
+  for (int category{}; category < maxCategories; ++category) {
+    frame[category].allocations =
+      categoryCounters[category].allocations.load(std::memory_order_relaxed) - frameStartAllocations[category];
+    frame[category].bytes = categoryCounters[category].bytes.load(std::memory_order_relaxed) - frameStartBytes[category];
+    lastFrame.allocations += frame[category].allocations;
+    lastFrame.bytes += frame[category].bytes;
+  }
+  const std::uint64_t frameIndex{frameCount++};
+  if (!steadyStateTest || frameIndex < steadyStateFrom || lastFrame.allocations == 0) {
+    return true;
+  }
+  // Not debug logging: this is the test's failure report.
+  std::cerr << "Allocation tracker: steady-state frame " << frameIndex << " made " << lastFrame.allocations
+    << " allocations, " << lastFrame.bytes << " bytes\n";
+  for (int category{}; category < maxCategories; ++category) {
+    if (frame[category].allocations > 0) {
+      std::cerr << "  " << categoryName(category) << ": " << frame[category].allocations << " allocations, "
+        << frame[category].bytes << " bytes\n";
+    }
+  }
+  return false;
+}
+
+AllocationCounts lastFrameAllocations() {
+  return lastFrame;
+}
+
+void enableSteadyStateTest(std::uint64_t warmupFrames) {
+  steadyStateTest = true;
+  steadyStateFrom = frameCount + warmupFrames;
+}
+
+void logAllocationReport() {
+#ifdef DEBUG
+  const int threads{std::min(threadCount.load(std::memory_order_relaxed), maxThreads)};
+  for (int thread{}; thread < threads; ++thread) {
+    const Counters& counters{threadCounters[thread]};
+    DEBUG_LOG_LINE(
+      "Allocations, thread " << thread << ": " << counters.allocations.load(std::memory_order_relaxed)
+      << " allocations, " << counters.bytes.load(std::memory_order_relaxed) << " bytes, "
+      << counters.deallocations.load(std::memory_order_relaxed) << " deallocations"
+    );
+  }
+  for (int category{}; category < maxCategories; ++category) {
+    const Counters& counters{categoryCounters[category]};
+    if (counters.allocations.load(std::memory_order_relaxed) > 0) {
+      DEBUG_LOG_LINE(
+        "Allocations, " << categoryName(category) << ": " << counters.allocations.load(std::memory_order_relaxed)
+        << " allocations, " << counters.bytes.load(std::memory_order_relaxed) << " bytes"
+      );
+    }
+  }
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef ALLOCATION_TRACKER_HXX
+#define ALLOCATION_TRACKER_HXX
+
+#include <cstdint>
+
+// Counting replacements for the global operator new and delete, compiled in
+// only when TRACK_ALLOCATIONS is defined. Without it the functions below
+// still exist but count nothing, so call sites need no #ifdefs.
+
+struct AllocationCounts {
+  std::uint64_t allocations;
+  std::uint64_t bytes;
+};
+
+// Attributes the allocations this thread makes while the scope is alive to
+// a category. Categories are told apart by pointer, so pass string literals.
+class AllocationScope {
+public:
+  explicit AllocationScope(const char* category);
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+  ~AllocationScope();
+
+private:
+  int previous;
+};
+
+bool allocationTrackingEnabled();
+// Everything the calling thread has allocated so far.
+AllocationCounts threadAllocations();
+
+// Frame accounting for the main loop. A frame's counts cover every thread.
+void beginAllocationFrame();
+// Returns false when steady-state testing is on, the warm-up is over and
+// the frame allocated; the offending categories are written to stderr.
+bool endAllocationFrame();
+AllocationCounts lastFrameAllocations();
+// Frames before warmupFrames may allocate, e.g. to grow pools and arenas.
+void enableSteadyStateTest(std::uint64_t warmupFrames);
+
+// Totals per thread and per category.
+void logAllocationReport();
+
+#endif // ALLOCATION_TRACKER_HXX
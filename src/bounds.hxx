@@ -0,0 +1,11 @@
+#ifndef BOUNDS_HXX
+#define BOUNDS_HXX
+
+#include <glm/glm.hpp>
+
+struct BoundingBox {
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+#endif // BOUNDS_HXX
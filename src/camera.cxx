@@ -0,0 +1,40 @@
+#include "camera.hxx"
+
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::dvec3 Camera::forward() const {
+  return glm::dvec3{
+    std::sin(yaw) * std::cos(pitch),
+    std::sin(pitch),
+    -std::cos(yaw) * std::cos(pitch)
+  };
+}
+
+glm::dvec3 Camera::right() const {
+  return glm::dvec3{std::cos(yaw), 0., std::sin(yaw)};
+}
+
+glm::mat4 Camera::rotation() const {
+  const glm::dvec3 up{glm::cross(right(), forward())};
+  return glm::mat4{glm::lookAt(glm::dvec3{0.}, forward(), up)};
+}
+
+glm::mat4 Camera::projection(float aspectRatio) const {
+  return glm::perspective(fieldOfView, aspectRatio, nearPlane, farPlane);
+}
+
+glm::vec3 Camera::relativePosition(const glm::dvec3& worldPosition) const {
+  // The subtraction must happen in double; only the small result is narrowed.
+  return glm::vec3{worldPosition - position};
+}
+
+glm::mat4 Camera::modelView(const glm::dvec3& worldPosition) const {
+  return glm::translate(rotation(), relativePosition(worldPosition));
+}
+
+BoundingBox Camera::relativeBounds(const glm::dvec3& worldPosition, const BoundingBox& localBounds) const {
+  const glm::vec3 offset{relativePosition(worldPosition)};
+  return BoundingBox{localBounds.min + offset, localBounds.max + offset};
+}
@@ -0,0 +1,31 @@
+#ifndef CAMERA_HXX
+#define CAMERA_HXX
+
+#include <glm/glm.hpp>
+
+#include "bounds.hxx"
+
+// World positions are kept in double precision. Nothing in world space is
+// ever uploaded to the GPU directly: every matrix is rebuilt relative to the
+// camera in double and only then narrowed to float, so the values the GPU
+// sees stay small and precise no matter how far the camera has flown.
+struct Camera {
+  glm::dvec3 position{};
+  // Radians. Yaw 0 looks down -Z; positive pitch looks up.
+  double yaw{};
+  double pitch{};
+  float fieldOfView{glm::radians(60.f)};
+  float nearPlane{.1f};
+  float farPlane{10000.f};
+
+  glm::dvec3 forward() const;
+  glm::dvec3 right() const;
+  // View rotation only; the translation lives in each model-view matrix.
+  glm::mat4 rotation() const;
+  glm::mat4 projection(float aspectRatio) const;
+  glm::vec3 relativePosition(const glm::dvec3& worldPosition) const;
+  glm::mat4 modelView(const glm::dvec3& worldPosition) const;
+  BoundingBox relativeBounds(const glm::dvec3& worldPosition, const BoundingBox& localBounds) const;
+};
+
+#endif // CAMERA_HXX
@@ -0,0 +1,168 @@
+#include "command_buffer.hxx"
+
+#include <cstring>
+
+#include "gpu_occlusion.hxx"
+
+namespace {
+
+struct BindTextureCommand {
+  GLuint unit;
+  GLenum target;
+  TextureHandle texture;
+};
+
+struct BindUniformsCommand {
+  GLuint binding;
+  GLintptr offset;
+  GLsizeiptr size;
+};
+
+struct DrawIndexedCommand {
+  GLenum mode;
+  GLsizei indexCount;
+  GLenum indexType;
+  GLintptr indexOffset;
+  GLint baseVertex;
+};
+
+// Payloads follow their one-byte type unaligned, so they are copied out.
+template <typename Payload>
+Payload read(const std::byte*& cursor) {
+  Payload payload;
+  std::memcpy(&payload, cursor, sizeof(payload));
+  cursor += sizeof(payload);
+  return payload;
+}
+
+} // namespace
+
+void CommandBuffer::write(CommandType type) {
+  stream.push_back(static_cast<std::byte>(type));
+}
+
+template <typename Payload>
+void CommandBuffer::write(CommandType type, const Payload& payload) {
+  write(type);
+  const std::size_t offset{stream.size()};
+  stream.resize(offset + sizeof(payload));
+  std::memcpy(stream.data() + offset, &payload, sizeof(payload));
+}
+
+void CommandBuffer::clear() {
+  stream.clear();
+  boundProgram = ProgramHandle{};
+  boundVertexArray = VertexArrayHandle{};
+  boundTextures.fill(TextureHandle{});
+}
+
+void CommandBuffer::bindProgram(ProgramHandle program) {
+  if (program == boundProgram) {
+    return;
+  }
+  boundProgram = program;
+  write(CommandType::BindProgram, program);
+}
+
+void CommandBuffer::bindVertexArray(VertexArrayHandle vertexArray) {
+  if (vertexArray == boundVertexArray) {
+    return;
+  }
+  boundVertexArray = vertexArray;
+  write(CommandType::BindVertexArray, vertexArray);
+}
+
+void CommandBuffer::bindTexture(GLuint unit, GLenum target, TextureHandle texture) {
+  if (unit < textureUnits) {
+    if (texture == boundTextures[unit]) {
+      return;
+    }
+    boundTextures[unit] = texture;
+  }
+  write(CommandType::BindTexture, BindTextureCommand{unit, target, texture});
+}
+
+void CommandBuffer::bindUniforms(GLuint binding, GLintptr offset, GLsizeiptr size) {
+  write(CommandType::BindUniforms, BindUniformsCommand{binding, offset, size});
+}
+
+void CommandBuffer::beginConditionalRender(std::uint32_t occlusionObject) {
+  write(CommandType::BeginConditionalRender, occlusionObject);
+}
+
+void CommandBuffer::endConditionalRender() {
+  write(CommandType::EndConditionalRender);
+}
+
+void CommandBuffer::drawIndexed(
+  GLenum mode,
+  GLsizei indexCount,
+  GLenum indexType,
+  GLintptr indexOffset,
+  GLint baseVertex
+) {
+  write(CommandType::DrawIndexed, DrawIndexedCommand{mode, indexCount, indexType, indexOffset, baseVertex});
+}
+
+void executeCommandBuffer(const CommandBuffer& buffer, const CommandContext& context) {
+  const std::byte* cursor{buffer.data().data()};
+  const std::byte* const end{cursor + buffer.data().size()};
+  // The culler may decide an object needs no query, so the end command only
+  // ends what its begin command actually started.
+  bool conditional{};
+  while (cursor < end) {
+    const CommandType type{read<CommandType>(cursor)};
+    switch (type) {
+    case CommandType::BindProgram: {
+      const ProgramHandle program{read<ProgramHandle>(cursor)};
+      glUseProgram(context.programOverride ? context.programOverride : context.resources.get(program));
+      break;
+    }
+    case CommandType::BindVertexArray:
+      glBindVertexArray(context.resources.get(read<VertexArrayHandle>(cursor)));
+      break;
+    case CommandType::BindTexture: {
+      const BindTextureCommand command{read<BindTextureCommand>(cursor)};
+      glActiveTexture(GL_TEXTURE0 + command.unit);
+      glBindTexture(command.target, context.resources.get(command.texture));
+      break;
+    }
+    case CommandType::BindUniforms: {
+      const BindUniformsCommand command{read<BindUniformsCommand>(cursor)};
+      glBindBufferRange(
+        GL_UNIFORM_BUFFER,
+        command.binding,
+        context.uniformBuffer,
+        context.uniformOffset + command.offset,
+        command.size
+      );
+      break;
+    }
+    case CommandType::BeginConditionalRender: {
+      const ConditionalRender condition{context.occlusionCuller.condition(read<std::uint32_t>(cursor))};
+      conditional = condition.query != 0;
+      if (conditional) {
+        glBeginConditionalRender(condition.query, condition.mode);
+      }
+      break;
+    }
+    case CommandType::EndConditionalRender:
+      if (conditional) {
+        glEndConditionalRender();
+        conditional = false;
+      }
+      break;
+    case CommandType::DrawIndexed: {
+      const DrawIndexedCommand command{read<DrawIndexedCommand>(cursor)};
+      glDrawElementsBaseVertex(
+        command.mode,
+        command.indexCount,
+        command.indexType,
+        reinterpret_cast<const void*>(command.indexOffset),
+        command.baseVertex
+      );
+      break;
+    }
+    }
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef COMMAND_BUFFER_HXX
+#define COMMAND_BUFFER_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+
+class GpuOcclusionCuller;
+
+enum class CommandType : std::uint8_t {
+  BindProgram,
+  BindVertexArray,
+  BindTexture,
+  BindUniforms,
+  BeginConditionalRender,
+  EndConditionalRender,
+  DrawIndexed,
+};
+
+// Packed stream of draw commands. Recording makes no GL calls and refers to
+// objects by handle, so any thread may record while the render thread
+// replays earlier buffers. Each buffer drops binds that repeat its own
+// previous bind, which keeps that filtering off the GL thread too.
+//
+// Uniform offsets are relative to the frame's uniform data; the base offset
+// in the stream buffer is only known when the render thread uploads it.
+class CommandBuffer {
+public:
+  static constexpr std::size_t textureUnits{8};
+
+  // Keeps the storage, so a reused buffer stops allocating once it has seen
+  // its largest frame.
+  void clear();
+
+  void bindProgram(ProgramHandle program);
+  void bindVertexArray(VertexArrayHandle vertexArray);
+  void bindTexture(GLuint unit, GLenum target, TextureHandle texture);
+  void bindUniforms(GLuint binding, GLintptr offset, GLsizeiptr size);
+  // Conditional on the occlusion query of a GPU occlusion culler object.
+  void beginConditionalRender(std::uint32_t occlusionObject);
+  void endConditionalRender();
+  void drawIndexed(GLenum mode, GLsizei indexCount, GLenum indexType, GLintptr indexOffset, GLint baseVertex);
+
+  bool empty() const { return stream.empty(); }
+  const std::vector<std::byte>& data() const { return stream; }
+
+private:
+  void write(CommandType type);
+  template <typename Payload>
+  void write(CommandType type, const Payload& payload);
+
+  std::vector<std::byte> stream{};
+  ProgramHandle boundProgram{};
+  VertexArrayHandle boundVertexArray{};
+  std::array<TextureHandle, textureUnits> boundTextures{};
+};
+
+// What replay needs to resolve a buffer's references on the render thread.
+struct CommandContext {
+  const GLResources& resources;
+  const GpuOcclusionCuller& occlusionCuller;
+  GLuint uniformBuffer;
+  GLintptr uniformOffset;
+  // When non-zero, bound instead of every recorded program, so a depth-only
+  // or debug pass can replay the scene's draws with its own shader.
+  GLuint programOverride{};
+};
+
+// Must run on the thread that owns the GL context.
+void executeCommandBuffer(const CommandBuffer& buffer, const CommandContext& context);
+
+#endif // COMMAND_BUFFER_HXX
@@ -0,0 +1,27 @@
+#ifndef DEBUG_HXX
+#define DEBUG_HXX
+
+#include <iostream>
+
+#define QUOTE(x) #x
+#define STRING(x) QUOTE(x)
+#ifdef _DEBUG
+#define DEBUG
+#endif
+#ifdef DEBUG
+#define DEBUG_LOG(s) do { std::cout << s; } while (false);
+#define DEBUG_ERROR(s) do { std::cerr << s; } while (false);
+#define DEBUG_LOG_LINE(s) do { std::cout << s << '\n'; } while (false);
+#define DEBUG_ERROR_LINE(s) do { std::cerr << s << '\n'; } while (false);
+#define DEBUG_LOG_NEWLINE() do { std::cout << '\n'; } while (false);
+#define DEBUG_ERROR_NEWLINE() do { std::cerr << '\n'; } while (false);
+#else
+#define DEBUG_LOG(s)
+#define DEBUG_ERROR(s)
+#define DEBUG_LOG_LINE(s)
+#define DEBUG_ERROR_LINE(s)
+#define DEBUG_LOG_NEWLINE()
+#define DEBUG_ERROR_NEWLINE()
+#endif
+
+#endif // DEBUG_HXX
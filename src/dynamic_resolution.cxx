@@ -0,0 +1,30 @@
+#include "dynamic_resolution.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) :
+  settings{settings},
+  currentScale{settings.maxScale} {}
+
+float DynamicResolution::update(float gpuMilliseconds) {
+  if (settlingFrames > 0) {
+    --settlingFrames;
+    return currentScale;
+  }
+  const float target{settings.targetMilliseconds};
+  if (gpuMilliseconds > target * (1.f + settings.overBudget)) {
+    currentScale *= std::sqrt(target / gpuMilliseconds);
+    fastFrames = 0;
+    settlingFrames = settings.latencyFrames;
+  } else if (gpuMilliseconds < target * (1.f - settings.underBudget)) {
+    if (++fastFrames >= settings.raiseDelay) {
+      currentScale += settings.raiseStep;
+      fastFrames = 0;
+    }
+  } else {
+    fastFrames = 0;
+  }
+  currentScale = std::clamp(currentScale, settings.minScale, settings.maxScale);
+  return currentScale;
+}
@@ -0,0 +1,43 @@
+#ifndef DYNAMIC_RESOLUTION_HXX
+#define DYNAMIC_RESOLUTION_HXX
+
+struct DynamicResolutionSettings {
+  // GPU time per frame to stay under.
+  float targetMilliseconds{14.f};
+  // Render scale limits, per axis.
+  float minScale{.5f};
+  float maxScale{1.f};
+  // Frames over target by more than this fraction lower the scale at once.
+  float overBudget{.05f};
+  // Only frames under target by more than this fraction count towards
+  // raising the scale again; between the two bands the scale holds.
+  float underBudget{.15f};
+  // Consecutive frames under budget before each step up.
+  int raiseDelay{30};
+  float raiseStep{.05f};
+  // Measurements arrive this many frames late, so after a drop the ones
+  // still taken at the old scale are ignored.
+  int latencyFrames{4};
+};
+
+// Hysteresis controller for the render scale. GPU cost follows pixel count,
+// so an overrun is corrected in one step by the square root of the ratio,
+// while the scale creeps back up only after a run of comfortably fast
+// frames. The dead band between them keeps it from oscillating around the
+// target.
+class DynamicResolution {
+public:
+  explicit DynamicResolution(const DynamicResolutionSettings& settings);
+
+  // Feeds one GPU frame time measured at the current scale.
+  float update(float gpuMilliseconds);
+  float scale() const { return currentScale; }
+
+private:
+  DynamicResolutionSettings settings;
+  float currentScale;
+  int fastFrames{};
+  int settlingFrames{};
+};
+
+#endif // DYNAMIC_RESOLUTION_HXX
@@ -0,0 +1,126 @@
+#include "frame_arena.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace {
+
+std::size_t alignUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+std::mutex& registryMutex() {
+  static std::mutex mutex{};
+  return mutex;
+}
+
+std::vector<FrameArena*>& registry() {
+  static std::vector<FrameArena*> arenas{};
+  return arenas;
+}
+
+struct RegisteredArena {
+  FrameArena arena{};
+  FrameArenaResource resource{arena};
+
+  RegisteredArena() {
+    const std::lock_guard<std::mutex> lock{registryMutex()};
+    registry().push_back(&arena);
+  }
+
+  ~RegisteredArena() {
+    const std::lock_guard<std::mutex> lock{registryMutex()};
+    std::vector<FrameArena*>& arenas{registry()};
+    arenas.erase(std::remove(arenas.begin(), arenas.end(), &arena), arenas.end());
+  }
+};
+
+RegisteredArena& threadArena() {
+  thread_local RegisteredArena arena{};
+  return arena;
+}
+
+} // namespace
+
+FrameArena::FrameArena(std::size_t capacity) :
+  block{std::make_unique<std::byte[]>(capacity)},
+  blockSize{capacity} {
+  overflow.reserve(16);
+}
+
+FrameArena::~FrameArena() {
+  releaseOverflow();
+}
+
+void* FrameArena::allocate(std::size_t size, std::size_t alignment) {
+  const std::uintptr_t base{reinterpret_cast<std::uintptr_t>(block.get())};
+  const std::size_t start{alignUp(base + offset, alignment) - base};
+  if (start + size <= blockSize) {
+    offset = start + size;
+    return block.get() + start;
+  }
+  void* pointer{::operator new(size, std::align_val_t{alignment})};
+  overflow.push_back(Overflow{pointer, size, alignment});
+  overflowBytes += size + alignment;
+  return pointer;
+}
+
+void FrameArena::reset() {
+  const std::size_t frameUsage{used()};
+  peak = std::max(peak, frameUsage);
+  if (!overflow.empty()) {
+    releaseOverflow();
+    ++overflowFrameCount;
+    // Grow with headroom so that a slowly growing workload settles quickly.
+    blockSize = std::max(blockSize * 2, frameUsage + frameUsage / 2);
+    block = std::make_unique<std::byte[]>(blockSize);
+  }
+  offset = 0;
+  overflowBytes = 0;
+}
+
+void FrameArena::releaseOverflow() {
+  for (const Overflow& allocation : overflow) {
+    ::operator delete(allocation.pointer, allocation.size, std::align_val_t{allocation.alignment});
+  }
+  overflow.clear();
+}
+
+void* FrameArenaResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+  return arena.allocate(bytes, alignment);
+}
+
+void FrameArenaResource::do_deallocate(void* /*pointer*/, std::size_t /*bytes*/, std::size_t /*alignment*/) {}
+
+bool FrameArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+FrameArena& threadFrameArena() {
+  return threadArena().arena;
+}
+
+std::pmr::memory_resource* threadFrameResource() {
+  return &threadArena().resource;
+}
+
+void resetFrameArenas() {
+  const std::lock_guard<std::mutex> lock{registryMutex()};
+  for (FrameArena* arena : registry()) {
+    arena->reset();
+  }
+}
+
+FrameArenaReport frameArenaReport() {
+  const std::lock_guard<std::mutex> lock{registryMutex()};
+  FrameArenaReport report{};
+  for (const FrameArena* arena : registry()) {
+    ++report.arenaCount;
+    report.capacity += arena->capacity();
+    report.highWaterMark += arena->highWaterMark();
+    report.overflowFrames += arena->overflowFrames();
+  }
+  return report;
+}
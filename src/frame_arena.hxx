@@ -0,0 +1,78 @@
+#ifndef FRAME_ARENA_HXX
+#define FRAME_ARENA_HXX
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for data that lives for a single frame. Deallocation is a
+// no-op; everything is released at once by reset(). If a frame outgrows the
+// block, the excess comes from the heap and the block is resized at the next
+// reset, so a steady-state frame makes no heap allocations at all.
+class FrameArena {
+public:
+  static constexpr std::size_t defaultCapacity{256 * 1024};
+
+  explicit FrameArena(std::size_t capacity = defaultCapacity);
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+  ~FrameArena();
+
+  void* allocate(std::size_t size, std::size_t alignment);
+  void reset();
+
+  std::size_t used() const { return offset + overflowBytes; }
+  std::size_t capacity() const { return blockSize; }
+  // Largest single-frame usage seen so far.
+  std::size_t highWaterMark() const { return peak; }
+  // Number of frames that had to fall back to the heap.
+  std::size_t overflowFrames() const { return overflowFrameCount; }
+
+private:
+  struct Overflow {
+    void* pointer;
+    std::size_t size;
+    std::size_t alignment;
+  };
+
+  void releaseOverflow();
+
+  std::unique_ptr<std::byte[]> block;
+  std::size_t blockSize;
+  std::size_t offset{};
+  std::size_t overflowBytes{};
+  std::size_t peak{};
+  std::size_t overflowFrameCount{};
+  std::vector<Overflow> overflow{};
+};
+
+class FrameArenaResource : public std::pmr::memory_resource {
+public:
+  explicit FrameArenaResource(FrameArena& arena) : arena{arena} {}
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  FrameArena& arena;
+};
+
+// Each thread gets its own arena on first use, so allocation never locks.
+FrameArena& threadFrameArena();
+std::pmr::memory_resource* threadFrameResource();
+// Resets every thread's arena. Only call while no thread holds frame data,
+// i.e. at the top of the frame.
+void resetFrameArenas();
+
+struct FrameArenaReport {
+  std::size_t arenaCount;
+  std::size_t capacity;
+  std::size_t highWaterMark;
+  std::size_t overflowFrames;
+};
+
+FrameArenaReport frameArenaReport();
+
+#endif // FRAME_ARENA_HXX
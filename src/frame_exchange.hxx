@@ -0,0 +1,76 @@
+#ifndef FRAME_EXCHANGE_HXX
+#define FRAME_EXCHANGE_HXX
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Hands frame packets from one producer thread to one consumer thread in
+// order. With three packets, one can be written while one waits and one is
+// consumed, so the producer runs at most two frames ahead and blocks after
+// that. Packets are reused, so any capacity they build up is kept.
+template <typename Packet, std::size_t packetCount = 3>
+class FrameExchange {
+public:
+  static_assert(packetCount >= 2, "A frame exchange needs at least two packets");
+
+  // Waits until a packet is free and returns it for writing.
+  Packet& beginWrite() {
+    std::unique_lock<std::mutex> lock{mutex};
+    changed.wait(lock, [this]() { return filled < packetCount; });
+    return packets[(readIndex + filled) % packetCount];
+  }
+
+  // Queues the packet returned by beginWrite().
+  void endWrite() {
+    {
+      const std::lock_guard<std::mutex> lock{mutex};
+      ++filled;
+      ++unread;
+    }
+    changed.notify_all();
+  }
+
+  // Waits for the oldest queued packet. Returns null once the exchange is
+  // closed and every queued packet has been read.
+  const Packet* beginRead() {
+    std::unique_lock<std::mutex> lock{mutex};
+    changed.wait(lock, [this]() { return unread > 0 || closed; });
+    if (unread == 0) {
+      return nullptr;
+    }
+    --unread;
+    return &packets[readIndex];
+  }
+
+  // Releases the packet returned by beginRead() for writing.
+  void endRead() {
+    {
+      const std::lock_guard<std::mutex> lock{mutex};
+      readIndex = (readIndex + 1) % packetCount;
+      --filled;
+    }
+    changed.notify_all();
+  }
+
+  void close() {
+    {
+      const std::lock_guard<std::mutex> lock{mutex};
+      closed = true;
+    }
+    changed.notify_all();
+  }
+
+private:
+  std::array<Packet, packetCount> packets{};
+  std::mutex mutex{};
+  std::condition_variable changed{};
+  // Packets queued or being read, starting at readIndex.
+  std::size_t readIndex{};
+  std::size_t filled{};
+  std::size_t unread{};
+  bool closed{};
+};
+
+#endif // FRAME_EXCHANGE_HXX
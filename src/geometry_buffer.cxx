@@ -0,0 +1,208 @@
+#include "geometry_buffer.hxx"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "debug.hxx"
+
+namespace {
+
+constexpr GLsizeiptr initialVertexBytes{4 * 1024 * 1024};
+constexpr std::uint32_t initialIndexBytes{4 * 1024 * 1024};
+// Enough for GL_UNSIGNED_INT indices; 16-bit ranges are padded to match.
+constexpr std::uint32_t indexAlignment{4};
+
+std::uint32_t alignUp(std::uint32_t value, std::uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+RangeAllocator::RangeAllocator(std::uint32_t capacity) {
+  grow(capacity);
+}
+
+std::uint32_t RangeAllocator::allocate(std::uint32_t size, std::uint32_t alignment) {
+  for (auto range{freeRanges.begin()}; range != freeRanges.end(); ++range) {
+    const std::uint32_t rangeStart{range->first};
+    const std::uint32_t rangeEnd{range->first + range->second};
+    const std::uint32_t start{alignUp(rangeStart, alignment)};
+    if (start > rangeEnd || rangeEnd - start < size) {
+      continue;
+    }
+    freeRanges.erase(range);
+    if (start > rangeStart) {
+      freeRanges.emplace(rangeStart, start - rangeStart);
+    }
+    if (start + size < rangeEnd) {
+      freeRanges.emplace(start + size, rangeEnd - start - size);
+    }
+    usedSize += size;
+    return start;
+  }
+  return invalidOffset;
+}
+
+void RangeAllocator::free(std::uint32_t offset, std::uint32_t size) {
+  if (size == 0) {
+    return;
+  }
+  usedSize -= size;
+  auto next{freeRanges.lower_bound(offset)};
+  if (next != freeRanges.begin()) {
+    const auto previous{std::prev(next)};
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      size += previous->second;
+      freeRanges.erase(previous);
+    }
+  }
+  if (next != freeRanges.end() && offset + size == next->first) {
+    size += next->second;
+    next = freeRanges.erase(next);
+  }
+  freeRanges.emplace_hint(next, offset, size);
+}
+
+void RangeAllocator::grow(std::uint32_t capacity) {
+  if (capacity <= totalSize) {
+    return;
+  }
+  const std::uint32_t oldSize{totalSize};
+  const std::uint32_t added{capacity - totalSize};
+  totalSize = capacity;
+  // Treat the new tail as a freed range so it merges with a free end.
+  usedSize += added;
+  free(oldSize, added);
+}
+
+GeometryBuffer::GeometryBuffer(GLResources& resources) :
+  resources{resources} {}
+
+GeometryRange GeometryBuffer::allocate(
+  const VertexFormat& format,
+  const void* vertices,
+  std::uint32_t vertexCount,
+  const void* indices,
+  std::uint32_t indexSize
+) {
+  const std::uint32_t poolIndex{findPool(format)};
+  Pool& pool{pools[poolIndex]};
+  const std::uint32_t paddedIndexSize{alignUp(indexSize, indexAlignment)};
+  std::uint32_t firstVertex{pool.vertices.allocate(vertexCount)};
+  std::uint32_t indexOffset{pool.indices.allocate(paddedIndexSize, indexAlignment)};
+  bool grown{};
+  if (firstVertex == RangeAllocator::invalidOffset) {
+    const std::uint32_t oldCapacity{pool.vertices.capacity()};
+    const std::uint32_t newCapacity{std::max(oldCapacity * 2, oldCapacity + vertexCount)};
+    pool.vertexBuffer = growBuffer(
+      pool.vertexBuffer,
+      static_cast<GLsizeiptr>(oldCapacity) * format.stride,
+      static_cast<GLsizeiptr>(newCapacity) * format.stride
+    );
+    pool.vertices.grow(newCapacity);
+    resources.memory().resize(pool.vertexMemory, static_cast<std::uint64_t>(newCapacity) * format.stride);
+    firstVertex = pool.vertices.allocate(vertexCount);
+    grown = true;
+  }
+  if (indexOffset == RangeAllocator::invalidOffset) {
+    const std::uint32_t oldCapacity{pool.indices.capacity()};
+    const std::uint32_t newCapacity{std::max(oldCapacity * 2, oldCapacity + paddedIndexSize)};
+    pool.indexBuffer = growBuffer(pool.indexBuffer, oldCapacity, newCapacity);
+    pool.indices.grow(newCapacity);
+    resources.memory().resize(pool.indexMemory, newCapacity);
+    indexOffset = pool.indices.allocate(paddedIndexSize, indexAlignment);
+    grown = true;
+  }
+  if (firstVertex == RangeAllocator::invalidOffset || indexOffset == RangeAllocator::invalidOffset) {
+    throw std::runtime_error{"Geometry buffer allocation failed"};
+  }
+  if (grown) {
+    specifyVertexArray(pool);
+    DEBUG_LOG_LINE(
+      "Geometry buffer: pool " << poolIndex << " grown to " << pool.vertices.capacity() << " vertices"
+      << ", " << pool.indices.capacity() << " index bytes"
+    );
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resources.get(pool.vertexBuffer));
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER,
+    static_cast<GLintptr>(firstVertex) * format.stride,
+    static_cast<GLsizeiptr>(vertexCount) * format.stride,
+    vertices
+  );
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resources.get(pool.indexBuffer));
+  glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, indexSize, indices);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return GeometryRange{poolIndex, firstVertex, vertexCount, indexOffset, paddedIndexSize};
+}
+
+void GeometryBuffer::free(const GeometryRange& range) {
+  Pool& pool{pools[range.pool]};
+  pool.vertices.free(range.firstVertex, range.vertexCount);
+  pool.indices.free(range.indexOffset, range.indexSize);
+}
+
+void GeometryBuffer::destroy() {
+  for (const Pool& pool : pools) {
+    resources.memory().untrack(pool.vertexMemory);
+    resources.memory().untrack(pool.indexMemory);
+    resources.destroy(pool.vao);
+    resources.destroy(pool.vertexBuffer);
+    resources.destroy(pool.indexBuffer);
+  }
+  pools.clear();
+}
+
+std::uint32_t GeometryBuffer::findPool(const VertexFormat& format) {
+  const auto existing{std::find_if(pools.begin(), pools.end(), [&format](const Pool& pool) {
+    return pool.format == format;
+  })};
+  if (existing != pools.end()) {
+    return static_cast<std::uint32_t>(existing - pools.begin());
+  }
+  const std::uint32_t vertexCapacity{static_cast<std::uint32_t>(initialVertexBytes / format.stride)};
+  Pool pool{
+    format,
+    resources.createVertexArray(),
+    resources.createBuffer(),
+    resources.createBuffer(),
+    resources.memory().track(MemoryCategory::Geometry, static_cast<std::uint64_t>(vertexCapacity) * format.stride),
+    resources.memory().track(MemoryCategory::Geometry, initialIndexBytes),
+    RangeAllocator{vertexCapacity},
+    RangeAllocator{initialIndexBytes}
+  };
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resources.get(pool.vertexBuffer));
+  glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexCapacity) * format.stride, nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resources.get(pool.indexBuffer));
+  glBufferData(GL_COPY_WRITE_BUFFER, initialIndexBytes, nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  specifyVertexArray(pool);
+  pools.push_back(std::move(pool));
+  DEBUG_LOG_LINE("Geometry buffer: pool " << pools.size() - 1 << " created for stride " << format.stride);
+  return static_cast<std::uint32_t>(pools.size() - 1);
+}
+
+BufferHandle GeometryBuffer::growBuffer(BufferHandle buffer, GLsizeiptr oldSize, GLsizeiptr newSize) {
+  const BufferHandle grown{resources.createBuffer()};
+  glBindBuffer(GL_COPY_READ_BUFFER, resources.get(buffer));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resources.get(grown));
+  glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  // Deletion waits for the frame's fence, so in-flight draws are unaffected.
+  resources.destroy(buffer);
+  return grown;
+}
+
+// Points the pool's VAO at its current buffers.
+void GeometryBuffer::specifyVertexArray(const Pool& pool) {
+  glBindVertexArray(resources.get(pool.vao));
+  glBindBuffer(GL_ARRAY_BUFFER, resources.get(pool.vertexBuffer));
+  applyVertexFormat(pool.format);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, resources.get(pool.indexBuffer));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,92 @@
+#ifndef GEOMETRY_BUFFER_HXX
+#define GEOMETRY_BUFFER_HXX
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+#include "vertex_format.hxx"
+
+// First-fit free list over [0, capacity). Freed ranges are merged with their
+// neighbors, so long-lived buffers do not fragment into unusable slivers.
+class RangeAllocator {
+public:
+  static constexpr std::uint32_t invalidOffset{~0u};
+
+  explicit RangeAllocator(std::uint32_t capacity = 0);
+
+  // Returns invalidOffset when no free range is large enough.
+  std::uint32_t allocate(std::uint32_t size, std::uint32_t alignment = 1);
+  void free(std::uint32_t offset, std::uint32_t size);
+  // Extends the range; existing allocations keep their offsets.
+  void grow(std::uint32_t capacity);
+
+  std::uint32_t capacity() const { return totalSize; }
+  std::uint32_t used() const { return usedSize; }
+
+private:
+  // Offset to size, ordered so that neighbors can be found for merging.
+  std::map<std::uint32_t, std::uint32_t> freeRanges{};
+  std::uint32_t totalSize{};
+  std::uint32_t usedSize{};
+};
+
+// Where a mesh lives inside the geometry buffer. Indices are relative to
+// firstVertex, which is passed as the base vertex when drawing.
+struct GeometryRange {
+  std::uint32_t pool;
+  std::uint32_t firstVertex;
+  std::uint32_t vertexCount;
+  // In bytes from the start of the pool's index buffer.
+  std::uint32_t indexOffset;
+  std::uint32_t indexSize;
+};
+
+// Suballocates meshes from one vertex buffer and one index buffer per vertex
+// format. Each format has a single VAO, so every mesh of that format draws
+// with glDrawElementsBaseVertex without rebinding anything. Full buffers
+// are grown by copying on the GPU; the VAO handle stays the same.
+class GeometryBuffer {
+public:
+  explicit GeometryBuffer(GLResources& resources);
+  GeometryBuffer(const GeometryBuffer&) = delete;
+  GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+  GeometryRange allocate(
+    const VertexFormat& format,
+    const void* vertices,
+    std::uint32_t vertexCount,
+    const void* indices,
+    std::uint32_t indexSize
+  );
+  void free(const GeometryRange& range);
+  // Destroys the buffers and VAOs of every pool. Like GLResources, this is
+  // not done by the destructor because it needs a current context.
+  void destroy();
+
+  VertexArrayHandle vertexArray(std::uint32_t pool) const { return pools[pool].vao; }
+
+private:
+  struct Pool {
+    VertexFormat format;
+    VertexArrayHandle vao;
+    BufferHandle vertexBuffer;
+    BufferHandle indexBuffer;
+    GpuMemoryBudget::Allocation vertexMemory;
+    GpuMemoryBudget::Allocation indexMemory;
+    RangeAllocator vertices;
+    RangeAllocator indices;
+  };
+
+  std::uint32_t findPool(const VertexFormat& format);
+  BufferHandle growBuffer(BufferHandle buffer, GLsizeiptr oldSize, GLsizeiptr newSize);
+  void specifyVertexArray(const Pool& pool);
+
+  GLResources& resources;
+  std::vector<Pool> pools{};
+};
+
+#endif // GEOMETRY_BUFFER_HXX
@@ -0,0 +1,178 @@
+#include "gl_resources.hxx"
+
+#include "debug.hxx"
+#include "shader.hxx"
+
+namespace {
+
+template <typename Tag>
+GLuint lookUp(const HandlePool<Tag>& pool, Handle<Tag> handle, const char* kind) {
+  const GLuint name{pool.get(handle)};
+#ifdef DEBUG
+  if (!name && handle) {
+    DEBUG_ERROR_LINE("GL resources: stale " << kind << " handle " << handle.index << '/' << handle.generation);
+  }
+#else
+  static_cast<void>(kind);
+#endif
+  return name;
+}
+
+} // namespace
+
+GLResources::~GLResources() {
+#ifdef DEBUG
+  const std::size_t leaked{
+    programs.liveNames().size() + vertexArrays.liveNames().size() + buffers.liveNames().size()
+    + textures.liveNames().size() + framebuffers.liveNames().size() + pending.size()
+  };
+  if (leaked > 0 || !retired.empty()) {
+    DEBUG_ERROR_LINE("GL resources: " << leaked << " objects still alive at shutdown");
+  }
+#endif
+}
+
+ProgramHandle GLResources::createProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+  return adoptProgram(::createProgram(vertexSource, fragmentSource));
+}
+
+ProgramHandle GLResources::adoptProgram(GLuint program) {
+  return programs.insert(program);
+}
+
+VertexArrayHandle GLResources::createVertexArray() {
+  GLuint name{};
+  glGenVertexArrays(1, &name);
+  return vertexArrays.insert(name);
+}
+
+BufferHandle GLResources::createBuffer() {
+  GLuint name{};
+  glGenBuffers(1, &name);
+  return buffers.insert(name);
+}
+
+TextureHandle GLResources::createTexture() {
+  GLuint name{};
+  glGenTextures(1, &name);
+  return textures.insert(name);
+}
+
+FramebufferHandle GLResources::createFramebuffer() {
+  GLuint name{};
+  glGenFramebuffers(1, &name);
+  return framebuffers.insert(name);
+}
+
+GLuint GLResources::get(ProgramHandle handle) const {
+  return lookUp(programs, handle, "program");
+}
+
+GLuint GLResources::get(VertexArrayHandle handle) const {
+  return lookUp(vertexArrays, handle, "vertex array");
+}
+
+GLuint GLResources::get(BufferHandle handle) const {
+  return lookUp(buffers, handle, "buffer");
+}
+
+GLuint GLResources::get(TextureHandle handle) const {
+  return lookUp(textures, handle, "texture");
+}
+
+GLuint GLResources::get(FramebufferHandle handle) const {
+  return lookUp(framebuffers, handle, "framebuffer");
+}
+
+void GLResources::destroy(ProgramHandle handle) {
+  retire(Kind::Program, programs.erase(handle));
+}
+
+void GLResources::destroy(VertexArrayHandle handle) {
+  retire(Kind::VertexArray, vertexArrays.erase(handle));
+}
+
+void GLResources::destroy(BufferHandle handle) {
+  retire(Kind::Buffer, buffers.erase(handle));
+}
+
+void GLResources::destroy(TextureHandle handle) {
+  retire(Kind::Texture, textures.erase(handle));
+}
+
+void GLResources::destroy(FramebufferHandle handle) {
+  retire(Kind::Framebuffer, framebuffers.erase(handle));
+}
+
+void GLResources::retire(Kind kind, GLuint name) {
+  if (name) {
+    pending.push_back(Deletion{kind, name});
+  }
+}
+
+void GLResources::endFrame() {
+  if (pending.empty()) {
+    return;
+  }
+  RetiredFrame frame{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), {}};
+  frame.deletions.swap(pending);
+  retired.push_back(std::move(frame));
+}
+
+void GLResources::collect() {
+  while (!retired.empty()) {
+    RetiredFrame& frame{retired.front()};
+    const GLenum status{glClientWaitSync(frame.fence, 0, 0)};
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return;
+    }
+    glDeleteSync(frame.fence);
+    for (const Deletion& deletion : frame.deletions) {
+      switch (deletion.kind) {
+        case Kind::Program:
+          glDeleteProgram(deletion.name);
+          break;
+        case Kind::VertexArray:
+          glDeleteVertexArrays(1, &deletion.name);
+          break;
+        case Kind::Buffer:
+          glDeleteBuffers(1, &deletion.name);
+          break;
+        case Kind::Texture:
+          glDeleteTextures(1, &deletion.name);
+          break;
+        case Kind::Framebuffer:
+          glDeleteFramebuffers(1, &deletion.name);
+          break;
+      }
+    }
+    retired.pop_front();
+  }
+}
+
+void GLResources::destroyAll() {
+  for (const GLuint program : programs.liveNames()) {
+    pending.push_back(Deletion{Kind::Program, program});
+  }
+  for (const GLuint vertexArray : vertexArrays.liveNames()) {
+    pending.push_back(Deletion{Kind::VertexArray, vertexArray});
+  }
+  for (const GLuint buffer : buffers.liveNames()) {
+    pending.push_back(Deletion{Kind::Buffer, buffer});
+  }
+  for (const GLuint texture : textures.liveNames()) {
+    pending.push_back(Deletion{Kind::Texture, texture});
+  }
+  for (const GLuint framebuffer : framebuffers.liveNames()) {
+    pending.push_back(Deletion{Kind::Framebuffer, framebuffer});
+  }
+  programs.clear();
+  vertexArrays.clear();
+  buffers.clear();
+  textures.clear();
+  framebuffers.clear();
+  endFrame();
+  // Shutdown is the one place where waiting for the GPU is fine.
+  glFinish();
+  collect();
+}
@@ -0,0 +1,192 @@
+#ifndef GL_RESOURCES_HXX
+#define GL_RESOURCES_HXX
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gpu_memory.hxx"
+
+// Typed, generational handle. The generation changes every time a slot is
+// reused, so a handle kept past destroy() is detected instead of silently
+// aliasing whatever object took its slot. The default handle is null.
+template <typename Tag>
+struct Handle {
+  std::uint32_t index{};
+  std::uint32_t generation{};
+
+  explicit operator bool() const { return generation != 0; }
+  bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+  bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+struct ProgramTag;
+struct VertexArrayTag;
+struct BufferTag;
+struct TextureTag;
+struct FramebufferTag;
+using ProgramHandle = Handle<ProgramTag>;
+using VertexArrayHandle = Handle<VertexArrayTag>;
+using BufferHandle = Handle<BufferTag>;
+using TextureHandle = Handle<TextureTag>;
+using FramebufferHandle = Handle<FramebufferTag>;
+
+// Sparse slots indirect into densely packed GL names, so create, lookup and
+// destroy are all O(1) and iterating live objects walks one flat array.
+template <typename Tag>
+class HandlePool {
+public:
+  Handle<Tag> insert(GLuint name) {
+    std::uint32_t slot{};
+    if (freeSlots.empty()) {
+      slot = static_cast<std::uint32_t>(slots.size());
+      slots.push_back(Slot{1, 0});
+    } else {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    slots[slot].denseIndex = static_cast<std::uint32_t>(names.size());
+    names.push_back(name);
+    denseSlots.push_back(slot);
+    return Handle<Tag>{slot, slots[slot].generation};
+  }
+
+  bool contains(Handle<Tag> handle) const {
+    return handle && handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+  }
+
+  // Returns 0 for null and stale handles.
+  GLuint get(Handle<Tag> handle) const {
+    return contains(handle) ? names[slots[handle.index].denseIndex] : 0;
+  }
+
+  // Removes the handle and returns its GL name, or 0 if it was stale.
+  GLuint erase(Handle<Tag> handle) {
+    if (!contains(handle)) {
+      return 0;
+    }
+    Slot& slot{slots[handle.index]};
+    const GLuint name{names[slot.denseIndex]};
+    names[slot.denseIndex] = names.back();
+    denseSlots[slot.denseIndex] = denseSlots.back();
+    slots[denseSlots[slot.denseIndex]].denseIndex = slot.denseIndex;
+    names.pop_back();
+    denseSlots.pop_back();
+    if (++slot.generation == 0) {
+      slot.generation = 1;
+    }
+    freeSlots.push_back(handle.index);
+    return name;
+  }
+
+  const std::vector<GLuint>& liveNames() const { return names; }
+
+  void clear() {
+    for (const std::uint32_t slot : denseSlots) {
+      if (++slots[slot].generation == 0) {
+        slots[slot].generation = 1;
+      }
+      freeSlots.push_back(slot);
+    }
+    names.clear();
+    denseSlots.clear();
+  }
+
+private:
+  struct Slot {
+    std::uint32_t generation;
+    std::uint32_t denseIndex;
+  };
+
+  std::vector<Slot> slots{};
+  std::vector<std::uint32_t> freeSlots{};
+  std::vector<GLuint> names{};
+  std::vector<std::uint32_t> denseSlots{};
+};
+
+// Owns every GL object created through it. destroy() invalidates the handle
+// immediately, but the GL name is only deleted once a fence shows that the
+// GPU has finished the frame in which it was destroyed.
+//
+// GL calls need a current context, so the destructor does not touch GL;
+// call destroyAll() before the context goes away.
+//
+// Whoever sizes an object's storage records it in memory(), so the budget
+// covers everything created through here.
+class GLResources {
+public:
+  GLResources() = default;
+  GLResources(const GLResources&) = delete;
+  GLResources& operator=(const GLResources&) = delete;
+  ~GLResources();
+
+  ProgramHandle createProgram(const std::string& vertexSource, const std::string& fragmentSource);
+  ProgramHandle adoptProgram(GLuint program);
+  VertexArrayHandle createVertexArray();
+  BufferHandle createBuffer();
+  TextureHandle createTexture();
+  FramebufferHandle createFramebuffer();
+
+  GLuint get(ProgramHandle handle) const;
+  GLuint get(VertexArrayHandle handle) const;
+  GLuint get(BufferHandle handle) const;
+  GLuint get(TextureHandle handle) const;
+  GLuint get(FramebufferHandle handle) const;
+
+  void destroy(ProgramHandle handle);
+  void destroy(VertexArrayHandle handle);
+  void destroy(BufferHandle handle);
+  void destroy(TextureHandle handle);
+  void destroy(FramebufferHandle handle);
+
+  // Deletes the objects of every retired frame whose fence has signaled.
+  // Never blocks.
+  void collect();
+  // Fences the objects destroyed during the frame that is ending.
+  void endFrame();
+  void destroyAll();
+
+  const std::vector<GLuint>& livePrograms() const { return programs.liveNames(); }
+  const std::vector<GLuint>& liveVertexArrays() const { return vertexArrays.liveNames(); }
+  const std::vector<GLuint>& liveBuffers() const { return buffers.liveNames(); }
+  const std::vector<GLuint>& liveTextures() const { return textures.liveNames(); }
+  const std::vector<GLuint>& liveFramebuffers() const { return framebuffers.liveNames(); }
+
+  GpuMemoryBudget& memory() { return memoryBudget; }
+  const GpuMemoryBudget& memory() const { return memoryBudget; }
+
+private:
+  enum class Kind {
+    Program,
+    VertexArray,
+    Buffer,
+    Texture,
+    Framebuffer,
+  };
+
+  struct Deletion {
+    Kind kind;
+    GLuint name;
+  };
+
+  struct RetiredFrame {
+    GLsync fence;
+    std::vector<Deletion> deletions;
+  };
+
+  void retire(Kind kind, GLuint name);
+
+  HandlePool<ProgramTag> programs{};
+  HandlePool<VertexArrayTag> vertexArrays{};
+  HandlePool<BufferTag> buffers{};
+  HandlePool<TextureTag> textures{};
+  HandlePool<FramebufferTag> framebuffers{};
+  std::vector<Deletion> pending{};
+  std::deque<RetiredFrame> retired{};
+  GpuMemoryBudget memoryBudget{};
+};
+
+#endif // GL_RESOURCES_HXX
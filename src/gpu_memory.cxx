@@ -0,0 +1,160 @@
+#include "gpu_memory.hxx"
+
+#include <algorithm>
+
+#include "debug.hxx"
+
+namespace {
+
+std::uint64_t bytesPerTexel(GLenum internalFormat) {
+  switch (internalFormat) {
+  case GL_R8:
+    return 1;
+  case GL_RG8:
+  case GL_R16F:
+  case GL_DEPTH_COMPONENT16:
+    return 2;
+  case GL_RGB8:
+  case GL_SRGB8:
+    // Drivers pad three-component formats to four.
+    return 4;
+  case GL_RG16F:
+  case GL_R32F:
+  case GL_RGBA8:
+  case GL_SRGB8_ALPHA8:
+  case GL_RGB10_A2:
+  case GL_R11F_G11F_B10F:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32F:
+  case GL_DEPTH24_STENCIL8:
+    return 4;
+  case GL_RGBA16F:
+  case GL_RG32F:
+  case GL_DEPTH32F_STENCIL8:
+    return 8;
+  case GL_RGBA32F:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+} // namespace
+
+const char* memoryCategoryName(MemoryCategory category) {
+  switch (category) {
+  case MemoryCategory::Geometry:
+    return "geometry";
+  case MemoryCategory::Texture:
+    return "texture";
+  case MemoryCategory::RenderTarget:
+    return "render target";
+  case MemoryCategory::Stream:
+    return "stream";
+  default:
+    return "unknown";
+  }
+}
+
+std::uint64_t textureMemorySize(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels) {
+  std::uint64_t texels{};
+  for (GLsizei level{}; level < levels; ++level) {
+    texels += static_cast<std::uint64_t>(width) * static_cast<std::uint64_t>(height);
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return texels * static_cast<std::uint64_t>(layers) * bytesPerTexel(internalFormat);
+}
+
+GpuMemoryBudget::GpuMemoryBudget(std::uint64_t budget) :
+  budget{budget} {}
+
+GpuMemoryBudget::Allocation GpuMemoryBudget::track(MemoryCategory category, std::uint64_t size) {
+  return insert(category, size, Evict{});
+}
+
+GpuMemoryBudget::Allocation GpuMemoryBudget::trackStreamable(MemoryCategory category, std::uint64_t size, Evict evict) {
+  return insert(category, size, std::move(evict));
+}
+
+void GpuMemoryBudget::resize(Allocation allocation, std::uint64_t size) {
+  Entry& entry{entries[allocation]};
+  currentSize[index(entry.category)] -= entry.size;
+  total -= entry.size;
+  entry.size = size;
+  add(entry.category, size);
+}
+
+void GpuMemoryBudget::untrack(Allocation allocation) {
+  Entry& entry{entries[allocation]};
+  if (entry.live) {
+    remove(entry, allocation);
+  }
+}
+
+void GpuMemoryBudget::touch(Allocation allocation) {
+  Entry& entry{entries[allocation]};
+  if (!entry.evict || entry.lastUsedFrame == frame) {
+    return;
+  }
+  entry.lastUsedFrame = frame;
+  recentlyUsed.splice(recentlyUsed.end(), recentlyUsed, entry.recent);
+}
+
+void GpuMemoryBudget::beginFrame() {
+  ++frame;
+  while (budget != 0 && total > budget && !recentlyUsed.empty()) {
+    const Allocation allocation{recentlyUsed.front()};
+    Entry& entry{entries[allocation]};
+    if (entry.lastUsedFrame + 1 >= frame) {
+      DEBUG_ERROR_LINE(
+        "GPU memory: " << total << " bytes in use exceeds the budget of " << budget
+        << " bytes with nothing left to evict"
+      );
+      break;
+    }
+    // Untrack first so the callback is free to allocate a replacement.
+    Evict evict{std::move(entry.evict)};
+    evicted += entry.size;
+    remove(entry, allocation);
+    evict();
+  }
+}
+
+GpuMemoryBudget::Allocation GpuMemoryBudget::insert(MemoryCategory category, std::uint64_t size, Evict evict) {
+  Allocation allocation{};
+  if (freeEntries.empty()) {
+    allocation = static_cast<Allocation>(entries.size());
+    entries.emplace_back();
+  } else {
+    allocation = freeEntries.back();
+    freeEntries.pop_back();
+  }
+  Entry& entry{entries[allocation]};
+  entry = Entry{category, size, frame, true, std::move(evict), recentlyUsed.end()};
+  if (entry.evict) {
+    entry.recent = recentlyUsed.insert(recentlyUsed.end(), allocation);
+  }
+  add(category, size);
+  return allocation;
+}
+
+void GpuMemoryBudget::add(MemoryCategory category, std::uint64_t size) {
+  std::uint64_t& categorySize{currentSize[index(category)]};
+  categorySize += size;
+  peakSize[index(category)] = std::max(peakSize[index(category)], categorySize);
+  total += size;
+  totalPeak = std::max(totalPeak, total);
+}
+
+void GpuMemoryBudget::remove(Entry& entry, Allocation allocation) {
+  currentSize[index(entry.category)] -= entry.size;
+  total -= entry.size;
+  if (entry.recent != recentlyUsed.end()) {
+    recentlyUsed.erase(entry.recent);
+    entry.recent = recentlyUsed.end();
+  }
+  entry.live = false;
+  entry.evict = Evict{};
+  freeEntries.push_back(allocation);
+}
@@ -0,0 +1,92 @@
+#ifndef GPU_MEMORY_HXX
+#define GPU_MEMORY_HXX
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <vector>
+
+#include <glad/gl.h>
+
+enum class MemoryCategory : std::uint8_t {
+  Geometry,
+  Texture,
+  RenderTarget,
+  Stream,
+  Count,
+};
+
+const char* memoryCategoryName(MemoryCategory category);
+
+// Estimated size of a texture with the given mip chain, assuming the driver
+// stores the internal format without padding.
+std::uint64_t textureMemorySize(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels);
+
+// Accounting for GPU memory allocated by the renderer. Sizes are estimates:
+// GL does not report real allocations, but what we asked for is a good
+// proxy when deciding what to give back.
+//
+// Streamable allocations carry an eviction callback. When usage is over
+// budget at the start of a frame, the least recently used ones are
+// untracked and their callbacks run until usage fits again; a callback
+// releases the resource but must not untrack it again. Allocations
+// used in the current or previous frame are never evicted, since their
+// draws may still be in flight.
+class GpuMemoryBudget {
+public:
+  using Allocation = std::uint32_t;
+  using Evict = std::function<void()>;
+
+  // A budget of 0 never evicts.
+  explicit GpuMemoryBudget(std::uint64_t budget = 0);
+
+  Allocation track(MemoryCategory category, std::uint64_t size);
+  Allocation trackStreamable(MemoryCategory category, std::uint64_t size, Evict evict);
+  void resize(Allocation allocation, std::uint64_t size);
+  void untrack(Allocation allocation);
+  // Marks the allocation as used this frame.
+  void touch(Allocation allocation);
+  // Advances the frame and evicts down to the budget.
+  void beginFrame();
+
+  void setBudget(std::uint64_t budget) { this->budget = budget; }
+  std::uint64_t budgetSize() const { return budget; }
+  std::uint64_t current(MemoryCategory category) const { return currentSize[index(category)]; }
+  std::uint64_t peak(MemoryCategory category) const { return peakSize[index(category)]; }
+  std::uint64_t currentTotal() const { return total; }
+  std::uint64_t peakTotal() const { return totalPeak; }
+  std::uint64_t evictedBytes() const { return evicted; }
+
+private:
+  static constexpr std::size_t categoryCount{static_cast<std::size_t>(MemoryCategory::Count)};
+
+  struct Entry {
+    MemoryCategory category;
+    std::uint64_t size;
+    std::uint64_t lastUsedFrame;
+    bool live;
+    Evict evict;
+    // Position in the LRU list; only meaningful for streamable entries.
+    std::list<Allocation>::iterator recent;
+  };
+
+  static std::size_t index(MemoryCategory category) { return static_cast<std::size_t>(category); }
+  Allocation insert(MemoryCategory category, std::uint64_t size, Evict evict);
+  void add(MemoryCategory category, std::uint64_t size);
+  void remove(Entry& entry, Allocation allocation);
+
+  std::uint64_t budget;
+  std::uint64_t frame{};
+  std::uint64_t total{};
+  std::uint64_t totalPeak{};
+  std::uint64_t evicted{};
+  std::array<std::uint64_t, categoryCount> currentSize{};
+  std::array<std::uint64_t, categoryCount> peakSize{};
+  std::vector<Entry> entries{};
+  std::vector<Allocation> freeEntries{};
+  // Streamable allocations, least recently used first.
+  std::list<Allocation> recentlyUsed{};
+};
+
+#endif // GPU_MEMORY_HXX
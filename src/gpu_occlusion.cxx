@@ -0,0 +1,123 @@
+#include "gpu_occlusion.hxx"
+
+namespace {
+
+constexpr GLsizei proxyVertexCount{36};
+constexpr float nearClipW{1e-4f};
+
+// Maps the unit cube drawn by proxy.vert onto the box.
+glm::mat4 boxToUnitCube(const BoundingBox& box) {
+  const glm::vec3 size{box.max - box.min};
+  return glm::mat4{
+    glm::vec4{size.x, 0.f, 0.f, 0.f},
+    glm::vec4{0.f, size.y, 0.f, 0.f},
+    glm::vec4{0.f, 0.f, size.z, 0.f},
+    glm::vec4{box.min, 1.f}
+  };
+}
+
+// A proxy that crosses the near plane gets clipped and may report zero
+// samples even though the camera is inside the object.
+bool crossesNearPlane(const glm::mat4& boxTransform) {
+  for (int corner{}; corner < 8; ++corner) {
+    const glm::vec4 position{
+      static_cast<float>(corner & 1),
+      static_cast<float>((corner >> 1) & 1),
+      static_cast<float>((corner >> 2) & 1),
+      1.f
+    };
+    if ((boxTransform * position).w < nearClipW) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+GpuOcclusionCuller::GpuOcclusionCuller(GLuint proxyProgram) :
+  proxyProgram{proxyProgram},
+  boxTransformLocation{glGetUniformLocation(proxyProgram, "boxTransform")} {
+  glGenVertexArrays(1, &proxyVAO);
+}
+
+GpuOcclusionCuller::~GpuOcclusionCuller() {
+  for (ObjectState& object : objects) {
+    glDeleteQueries(1, &object.query);
+  }
+  glDeleteVertexArrays(1, &proxyVAO);
+}
+
+std::uint32_t GpuOcclusionCuller::addObject() {
+  ObjectState object{};
+  glGenQueries(1, &object.query);
+  object.visible = true;
+  objects.push_back(object);
+  return static_cast<std::uint32_t>(objects.size() - 1);
+}
+
+void GpuOcclusionCuller::beginFrame() {
+  ++frame;
+  for (ObjectState& object : objects) {
+    if (!object.resultPending) {
+      continue;
+    }
+    GLuint available{};
+    glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint samplesPassed{};
+      glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &samplesPassed);
+      object.visible = samplesPassed != 0;
+      object.resultPending = false;
+    }
+  }
+}
+
+ConditionalRender GpuOcclusionCuller::condition(std::uint32_t object) const {
+  const ObjectState& state{objects[object]};
+  if (state.queriedFrame != 0 && state.queriedFrame + 1 == frame) {
+    // Issued at the end of last frame; the wait happens on the GPU only.
+    return ConditionalRender{state.query, GL_QUERY_WAIT};
+  }
+  if (!state.visible && state.queriedFrame != 0) {
+    return ConditionalRender{state.query, GL_QUERY_NO_WAIT};
+  }
+  return ConditionalRender{0, 0};
+}
+
+bool GpuOcclusionCuller::needsQuery(std::uint32_t object) const {
+  const ObjectState& state{objects[object]};
+  return !state.visible || (frame + object) % visibleQueryInterval == 0;
+}
+
+void GpuOcclusionCuller::queryObjects(const glm::mat4& viewProjection, const std::vector<BoundingBox>& bounds) {
+  glUseProgram(proxyProgram);
+  glBindVertexArray(proxyVAO);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_DEPTH_TEST);
+  // The object itself may already be in the depth buffer at the same depth.
+  glDepthFunc(GL_LEQUAL);
+  for (std::uint32_t object{}; object < objects.size(); ++object) {
+    if (!needsQuery(object)) {
+      continue;
+    }
+    ObjectState& state{objects[object]};
+    const glm::mat4 boxTransform{viewProjection * boxToUnitCube(bounds[object])};
+    if (crossesNearPlane(boxTransform)) {
+      state.visible = true;
+      state.resultPending = false;
+      continue;
+    }
+    glUniformMatrix4fv(boxTransformLocation, 1, GL_FALSE, &boxTransform[0][0]);
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, state.query);
+    glDrawArrays(GL_TRIANGLES, 0, proxyVertexCount);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    state.queriedFrame = frame;
+    state.resultPending = true;
+  }
+  glDepthFunc(GL_LESS);
+  glDisable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
@@ -0,0 +1,58 @@
+#ifndef GPU_OCCLUSION_HXX
+#define GPU_OCCLUSION_HXX
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "bounds.hxx"
+
+// A draw wrapped in glBeginConditionalRender when query is non-zero.
+struct ConditionalRender {
+  GLuint query;
+  GLenum mode;
+};
+
+// GPU occlusion culling with GL_ANY_SAMPLES_PASSED queries. Bounding-box
+// proxies are drawn after the opaque pass of frame N, against that frame's
+// depth buffer, and frame N+1 draws the object under conditional rendering.
+// The GPU waits on the query result itself, so the CPU never stalls; results
+// are also read back lazily to decide which objects need querying at all.
+class GpuOcclusionCuller {
+public:
+  // Objects that were last seen visible are re-queried this rarely,
+  // staggered by object so the proxy cost is spread across frames.
+  static constexpr std::uint64_t visibleQueryInterval{8};
+
+  explicit GpuOcclusionCuller(GLuint proxyProgram);
+  GpuOcclusionCuller(const GpuOcclusionCuller&) = delete;
+  GpuOcclusionCuller& operator=(const GpuOcclusionCuller&) = delete;
+  ~GpuOcclusionCuller();
+
+  std::uint32_t addObject();
+  void beginFrame();
+  ConditionalRender condition(std::uint32_t object) const;
+  // Expects the depth buffer of the current frame's opaque pass to be bound.
+  // bounds is indexed by the IDs returned from addObject.
+  void queryObjects(const glm::mat4& viewProjection, const std::vector<BoundingBox>& bounds);
+
+private:
+  struct ObjectState {
+    GLuint query;
+    std::uint64_t queriedFrame;
+    bool visible;
+    bool resultPending;
+  };
+
+  bool needsQuery(std::uint32_t object) const;
+
+  GLuint proxyProgram;
+  GLint boxTransformLocation;
+  GLuint proxyVAO{};
+  std::uint64_t frame{};
+  std::vector<ObjectState> objects{};
+};
+
+#endif // GPU_OCCLUSION_HXX
@@ -0,0 +1,79 @@
+#include "gpu_timer.hxx"
+
+#include <algorithm>
+
+GpuTimer::GpuTimer(std::size_t scopeCount) :
+  latest(scopeCount, -1.f) {
+  for (Frame& frame : frames) {
+    frame.queries.resize(scopeCount * 2);
+    frame.timed.resize(scopeCount);
+    glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+  }
+}
+
+GpuTimer::~GpuTimer() {
+  for (Frame& frame : frames) {
+    glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+  }
+}
+
+bool GpuTimer::beginFrame() {
+  bool measured{};
+  // Oldest first, so that the latest values really are the latest.
+  for (int offset{1}; offset <= framesInFlight; ++offset) {
+    Frame& frame{frames[(current + offset) % framesInFlight]};
+    if (frame.pending && collect(frame)) {
+      measured = true;
+    }
+  }
+  current = (current + 1) % framesInFlight;
+  Frame& frame{frames[current]};
+  skipping = frame.pending;
+  if (!skipping) {
+    std::fill(frame.timed.begin(), frame.timed.end(), false);
+  }
+  return measured;
+}
+
+void GpuTimer::begin(std::size_t scope) {
+  if (skipping) {
+    return;
+  }
+  Frame& frame{frames[current]};
+  glQueryCounter(frame.queries[scope * 2], GL_TIMESTAMP);
+  frame.pending = true;
+}
+
+void GpuTimer::end(std::size_t scope) {
+  if (skipping) {
+    return;
+  }
+  Frame& frame{frames[current]};
+  glQueryCounter(frame.queries[scope * 2 + 1], GL_TIMESTAMP);
+  frame.timed[scope] = true;
+}
+
+bool GpuTimer::collect(Frame& frame) {
+  for (std::size_t scope{}; scope < frame.timed.size(); ++scope) {
+    if (!frame.timed[scope]) {
+      continue;
+    }
+    GLint available{};
+    glGetQueryObjectiv(frame.queries[scope * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      return false;
+    }
+  }
+  for (std::size_t scope{}; scope < frame.timed.size(); ++scope) {
+    if (!frame.timed[scope]) {
+      continue;
+    }
+    GLuint64 start{};
+    GLuint64 end{};
+    glGetQueryObjectui64v(frame.queries[scope * 2], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(frame.queries[scope * 2 + 1], GL_QUERY_RESULT, &end);
+    latest[scope] = static_cast<float>(end - start) * 1e-6f;
+  }
+  frame.pending = false;
+  return true;
+}
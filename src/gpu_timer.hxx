@@ -0,0 +1,50 @@
+#ifndef GPU_TIMER_HXX
+#define GPU_TIMER_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+// Measures GPU time between pairs of timestamp queries. Unlike
+// GL_TIME_ELAPSED queries, timestamps may overlap and nest, so any number of
+// scopes can be timed in a frame. Results are collected only once they are
+// available, several frames later, so reading never stalls; a frame whose
+// queries are still pending when its slot comes round again goes unmeasured.
+class GpuTimer {
+public:
+  static constexpr int framesInFlight{4};
+
+  explicit GpuTimer(std::size_t scopeCount);
+  GpuTimer(const GpuTimer&) = delete;
+  GpuTimer& operator=(const GpuTimer&) = delete;
+  ~GpuTimer();
+
+  // Collects finished frames and starts timing a new one. Returns true when
+  // new measurements arrived.
+  bool beginFrame();
+  void begin(std::size_t scope);
+  void end(std::size_t scope);
+  // Latest measurement, or a negative value before the first one.
+  float milliseconds(std::size_t scope) const { return latest[scope]; }
+
+private:
+  struct Frame {
+    // A start and an end timestamp per scope.
+    std::vector<GLuint> queries;
+    std::vector<bool> timed;
+    bool pending;
+  };
+
+  bool collect(Frame& frame);
+
+  std::array<Frame, framesInFlight> frames{};
+  std::vector<float> latest;
+  int current{framesInFlight - 1};
+  // Set when the current slot is still pending, so this frame is skipped.
+  bool skipping{};
+};
+
+#endif // GPU_TIMER_HXX
@@ -0,0 +1,97 @@
+#include "input.hxx"
+
+#include "debug.hxx"
+
+namespace {
+
+void pushEvent(GLFWwindow* window, InputEvent event) {
+  event.time = glfwGetTime();
+  InputQueue* queue{static_cast<InputQueue*>(glfwGetWindowUserPointer(window))};
+  if (!queue->push(event)) {
+    DEBUG_ERROR_LINE("Input: event queue full, event dropped");
+  }
+}
+
+void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int mods) {
+  pushEvent(window, InputEvent{InputEventType::Key, key, action, mods, 0., 0., 0.});
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+  pushEvent(window, InputEvent{InputEventType::MouseButton, button, action, mods, 0., 0., 0.});
+}
+
+void cursorPositionCallback(GLFWwindow* window, double x, double y) {
+  pushEvent(window, InputEvent{InputEventType::CursorPosition, 0, 0, 0, x, y, 0.});
+}
+
+void scrollCallback(GLFWwindow* window, double x, double y) {
+  pushEvent(window, InputEvent{InputEventType::Scroll, 0, 0, 0, x, y, 0.});
+}
+
+void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+  pushEvent(window, InputEvent{
+    InputEventType::FramebufferSize,
+    0,
+    0,
+    0,
+    static_cast<double>(width),
+    static_cast<double>(height),
+    0.
+  });
+}
+
+} // namespace
+
+void installInputCallbacks(GLFWwindow* window, InputQueue& queue) {
+  glfwSetWindowUserPointer(window, &queue);
+  glfwSetKeyCallback(window, keyCallback);
+  glfwSetMouseButtonCallback(window, mouseButtonCallback);
+  glfwSetCursorPosCallback(window, cursorPositionCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+}
+
+InputState::InputState(GLFWwindow* window) {
+  glfwGetCursorPos(window, &cursor.x, &cursor.y);
+  glfwGetFramebufferSize(window, &framebuffer.x, &framebuffer.y);
+}
+
+void InputState::update(InputQueue& queue) {
+  pressedKeys.reset();
+  releasedKeys.reset();
+  cursorMotion = glm::dvec2{0.};
+  scroll = glm::dvec2{0.};
+  InputEvent event{};
+  while (queue.pop(event)) {
+    apply(event);
+  }
+}
+
+void InputState::apply(const InputEvent& event) {
+  switch (event.type) {
+  case InputEventType::Key:
+    mods = event.mods;
+    if (!validKey(event.code) || event.action == GLFW_REPEAT) {
+      break;
+    }
+    keys[event.code] = event.action == GLFW_PRESS;
+    (event.action == GLFW_PRESS ? pressedKeys : releasedKeys)[event.code] = true;
+    break;
+  case InputEventType::MouseButton:
+    mods = event.mods;
+    if (event.code >= 0 && event.code <= GLFW_MOUSE_BUTTON_LAST) {
+      buttons[event.code] = event.action == GLFW_PRESS;
+    }
+    break;
+  case InputEventType::CursorPosition:
+    cursorMotion += glm::dvec2{event.x, event.y} - cursor;
+    cursor = glm::dvec2{event.x, event.y};
+    break;
+  case InputEventType::Scroll:
+    scroll += glm::dvec2{event.x, event.y};
+    break;
+  case InputEventType::FramebufferSize:
+    framebuffer = glm::ivec2{static_cast<int>(event.x), static_cast<int>(event.y)};
+    break;
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef INPUT_HXX
+#define INPUT_HXX
+
+#include <bitset>
+#include <cstdint>
+
+#ifndef GLFW_INCLUDE_NONE
+#define GLFW_INCLUDE_NONE
+#endif
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "spsc_queue.hxx"
+
+enum class InputEventType : std::uint8_t {
+  Key,
+  MouseButton,
+  CursorPosition,
+  Scroll,
+  FramebufferSize,
+};
+
+struct InputEvent {
+  InputEventType type;
+  // Key or mouse button, GLFW_PRESS/GLFW_RELEASE/GLFW_REPEAT, modifier bits.
+  int code;
+  int action;
+  int mods;
+  // Cursor position, scroll offset or framebuffer size.
+  double x;
+  double y;
+  // glfwGetTime() when the callback ran.
+  double time;
+};
+
+// Produced by the GLFW callbacks on the thread that polls events.
+using InputQueue = SpscQueue<InputEvent, 1024>;
+
+// Points every input callback of the window at the queue through the window
+// user pointer. The queue must outlive event polling.
+void installInputCallbacks(GLFWwindow* window, InputQueue& queue);
+
+// Input as seen by one simulation tick. Key and button state are bitsets;
+// pressed and released record edges within the tick, so a tap shorter than
+// a tick is still seen.
+class InputState {
+public:
+  explicit InputState(GLFWwindow* window);
+
+  // Clears the previous tick's edges and deltas, then applies every queued
+  // event in order.
+  void update(InputQueue& queue);
+  void apply(const InputEvent& event);
+
+  bool keyDown(int key) const { return validKey(key) && keys[key]; }
+  bool keyPressed(int key) const { return validKey(key) && pressedKeys[key]; }
+  bool keyReleased(int key) const { return validKey(key) && releasedKeys[key]; }
+  bool buttonDown(int button) const { return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && buttons[button]; }
+  // Modifier bits of the most recent key or button event.
+  int modifiers() const { return mods; }
+  glm::dvec2 cursorPosition() const { return cursor; }
+  glm::dvec2 cursorDelta() const { return cursorMotion; }
+  glm::dvec2 scrollDelta() const { return scroll; }
+  glm::ivec2 framebufferSize() const { return framebuffer; }
+
+private:
+  static bool validKey(int key) { return key >= 0 && key <= GLFW_KEY_LAST; }
+
+  std::bitset<GLFW_KEY_LAST + 1> keys{};
+  std::bitset<GLFW_KEY_LAST + 1> pressedKeys{};
+  std::bitset<GLFW_KEY_LAST + 1> releasedKeys{};
+  std::bitset<GLFW_MOUSE_BUTTON_LAST + 1> buttons{};
+  int mods{};
+  glm::dvec2 cursor{0.};
+  glm::dvec2 cursorMotion{0.};
+  glm::dvec2 scroll{0.};
+  glm::ivec2 framebuffer{0};
+};
+
+#endif // INPUT_HXX
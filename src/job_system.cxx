@@ -0,0 +1,201 @@
+#include "job_system.hxx"
+
+#include <algorithm>
+
+#include "debug.hxx"
+
+namespace {
+
+constexpr std::int64_t dequeCapacity{4096};
+// Ring of job records per thread. A record is reused after this many more
+// submissions from the same thread, by which time it has long finished.
+constexpr std::uint32_t jobPoolSize{8192};
+constexpr int idleSpins{64};
+
+// Index of the calling thread within the system it belongs to.
+thread_local const JobSystem* currentSystem{};
+thread_local unsigned currentWorker{};
+
+} // namespace
+
+struct JobSystem::Job {
+  JobFunction function;
+  void* data;
+  std::uint32_t begin;
+  std::uint32_t end;
+  JobCounter* counter;
+};
+
+// Chase-Lev deque, with the memory orderings of Lê et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (2013). Only the owner
+// pushes and pops at the bottom; any thread may steal from the top.
+// The capacity is fixed and a full deque refuses pushes.
+struct JobSystem::Worker {
+  std::atomic<std::int64_t> top{};
+  std::atomic<std::int64_t> bottom{};
+  std::vector<std::atomic<Job*>> slots;
+  std::vector<Job> jobPool;
+  std::uint32_t nextJob{};
+  std::uint32_t randomState;
+
+  explicit Worker(std::uint32_t seed) :
+    slots(dequeCapacity), jobPool(jobPoolSize), randomState{seed | 1u} {}
+
+  bool push(Job* job) {
+    const std::int64_t b{bottom.load(std::memory_order_relaxed)};
+    const std::int64_t t{top.load(std::memory_order_acquire)};
+    if (b - t >= dequeCapacity) {
+      return false;
+    }
+    // Release/acquire on the slot publishes the job record to the thread
+    // that takes it; the fences below only order the indices.
+    slots[b % dequeCapacity].store(job, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  Job* pop() {
+    const std::int64_t b{bottom.load(std::memory_order_relaxed) - 1};
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t{top.load(std::memory_order_relaxed)};
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Job* job{slots[b % dequeCapacity].load(std::memory_order_acquire)};
+    if (t == b) {
+      // Last job: race the thieves for it.
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  Job* steal() {
+    std::int64_t t{top.load(std::memory_order_acquire)};
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b{bottom.load(std::memory_order_acquire)};
+    if (t >= b) {
+      return nullptr;
+    }
+    Job* job{slots[t % dequeCapacity].load(std::memory_order_acquire)};
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return job;
+  }
+
+  std::uint32_t random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+  }
+};
+
+JobSystem::JobSystem(unsigned threadCount) :
+  threads{threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())} {
+  for (unsigned i{}; i < threads; ++i) {
+    workers.push_back(std::make_unique<Worker>(0x9e3779b9u * (i + 1)));
+  }
+  currentSystem = this;
+  currentWorker = 0;
+  threadPool.reserve(threads - 1);
+  for (unsigned i{1}; i < threads; ++i) {
+    threadPool.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+  DEBUG_LOG_LINE("Job system: " << threads << " threads");
+}
+
+JobSystem::~JobSystem() {
+  {
+    const std::lock_guard<std::mutex> lock{sleepMutex};
+    stopping.store(true);
+  }
+  wake.notify_all();
+  for (std::thread& thread : threadPool) {
+    thread.join();
+  }
+  if (currentSystem == this) {
+    currentSystem = nullptr;
+  }
+}
+
+void JobSystem::run(JobFunction function, void* data, std::uint32_t begin, std::uint32_t end, JobCounter& counter) {
+  counter.pending.fetch_add(1, std::memory_order_relaxed);
+  if (currentSystem != this) {
+    Job job{function, data, begin, end, &counter};
+    execute(job);
+    return;
+  }
+  Worker& worker{*workers[currentWorker]};
+  Job& job{worker.jobPool[worker.nextJob++ % jobPoolSize]};
+  job = Job{function, data, begin, end, &counter};
+  if (!worker.push(&job)) {
+    execute(job);
+    return;
+  }
+  queuedJobs.fetch_add(1);
+  if (sleepingWorkers.load() > 0) {
+    const std::lock_guard<std::mutex> lock{sleepMutex};
+    wake.notify_one();
+  }
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+  while (!counter.done()) {
+    if (currentSystem != this || !runOne(currentWorker)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool JobSystem::runOne(unsigned worker) {
+  Worker& self{*workers[worker]};
+  Job* job{self.pop()};
+  if (!job && threads > 1) {
+    const unsigned first{self.random() % threads};
+    for (unsigned i{}; i < threads && !job; ++i) {
+      const unsigned victim{(first + i) % threads};
+      if (victim != worker) {
+        job = workers[victim]->steal();
+      }
+    }
+  }
+  if (!job) {
+    return false;
+  }
+  queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  execute(*job);
+  return true;
+}
+
+void JobSystem::execute(Job& job) {
+  job.function(job.data, job.begin, job.end);
+  job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(unsigned worker) {
+  currentSystem = this;
+  currentWorker = worker;
+  int spins{};
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (runOne(worker)) {
+      spins = 0;
+      continue;
+    }
+    if (++spins < idleSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    sleepingWorkers.fetch_add(1);
+    wake.wait(lock, [this]() { return queuedJobs.load() > 0 || stopping.load(); });
+    sleepingWorkers.fetch_sub(1);
+  }
+}
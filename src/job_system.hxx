@@ -0,0 +1,93 @@
+#ifndef JOB_SYSTEM_HXX
+#define JOB_SYSTEM_HXX
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the unfinished jobs of a batch. A job depends on other jobs by
+// waiting on their counter.
+class JobCounter {
+public:
+  bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<std::uint32_t> pending{};
+};
+
+using JobFunction = void (*)(void* data, std::uint32_t begin, std::uint32_t end);
+
+// Fixed pool of worker threads, each with a Chase-Lev work-stealing deque.
+// Workers run their own newest jobs first and steal the oldest jobs of the
+// others when they run dry. Submitting never allocates: jobs come from a
+// per-thread ring that is sized once.
+//
+// Only the thread that created the system and the workers themselves may
+// submit; jobs submitted from any other thread run inline. Waiting runs
+// other jobs instead of blocking, so jobs may wait on their own children.
+class JobSystem {
+public:
+  // 0 uses every hardware thread. The count includes the creating thread.
+  explicit JobSystem(unsigned threadCount = 0);
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  ~JobSystem();
+
+  void run(JobFunction function, void* data, std::uint32_t begin, std::uint32_t end, JobCounter& counter);
+  void wait(const JobCounter& counter);
+
+  // Calls function(begin, end) over [0, count) in chunks of at least grain
+  // and returns when every chunk has finished.
+  template <typename Function>
+  void parallelFor(std::uint32_t count, std::uint32_t grain, const Function& function) {
+    if (count == 0) {
+      return;
+    }
+    const std::uint32_t chunkSize{std::max(grain, (count + threads * chunksPerThread - 1) / (threads * chunksPerThread))};
+    if (threads == 1 || chunkSize >= count) {
+      function(0u, count);
+      return;
+    }
+    const JobFunction trampoline{[](void* data, std::uint32_t begin, std::uint32_t end) {
+      (*static_cast<const Function*>(data))(begin, end);
+    }};
+    void* data{const_cast<void*>(static_cast<const void*>(&function))};
+    JobCounter counter{};
+    for (std::uint32_t begin{chunkSize}; begin < count; begin += chunkSize) {
+      run(trampoline, data, begin, std::min(count, begin + chunkSize), counter);
+    }
+    function(0u, chunkSize);
+    wait(counter);
+  }
+
+  unsigned threadCount() const { return threads; }
+
+private:
+  // More chunks than threads so that stealing can even out uneven chunks.
+  static constexpr std::uint32_t chunksPerThread{4};
+
+  struct Job;
+  struct Worker;
+
+  bool runOne(unsigned worker);
+  void execute(Job& job);
+  void workerLoop(unsigned worker);
+
+  unsigned threads;
+  std::vector<std::unique_ptr<Worker>> workers{};
+  std::vector<std::thread> threadPool{};
+  std::atomic<bool> stopping{};
+  // Jobs pushed but not yet taken, and workers asleep waiting for them.
+  std::atomic<int> queuedJobs{};
+  std::atomic<int> sleepingWorkers{};
+  std::mutex sleepMutex{};
+  std::condition_variable wake{};
+};
+
+#endif // JOB_SYSTEM_HXX
@@ -0,0 +1,161 @@
+#include "light_clusters.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+struct ClusterBox {
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+float sliceDepth(int slice, float nearPlane, float farPlane) {
+  return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / LightClusterer::slices);
+}
+
+// Returns a bit per light of the four starting at first whose sphere
+// touches the box.
+int testLights(const float* x, const float* y, const float* z, const float* radius, const ClusterBox& box) {
+#ifdef LIGHT_CLUSTERS_SSE2
+  const __m128 zero{_mm_setzero_ps()};
+  const __m128 cx{_mm_loadu_ps(x)};
+  const __m128 cy{_mm_loadu_ps(y)};
+  const __m128 cz{_mm_loadu_ps(z)};
+  const __m128 r{_mm_loadu_ps(radius)};
+  // Distance from each center to the box along each axis, zero inside.
+  const __m128 dx{_mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.x), cx), _mm_sub_ps(cx, _mm_set1_ps(box.max.x))), zero)};
+  const __m128 dy{_mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.y), cy), _mm_sub_ps(cy, _mm_set1_ps(box.max.y))), zero)};
+  const __m128 dz{_mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box.min.z), cz), _mm_sub_ps(cz, _mm_set1_ps(box.max.z))), zero)};
+  const __m128 distance{_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))};
+  return _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(r, r)));
+#else
+  int mask{};
+  for (int lane{}; lane < 4; ++lane) {
+    const float dx{std::max({box.min.x - x[lane], x[lane] - box.max.x, 0.f})};
+    const float dy{std::max({box.min.y - y[lane], y[lane] - box.max.y, 0.f})};
+    const float dz{std::max({box.min.z - z[lane], z[lane] - box.max.z, 0.f})};
+    if (dx * dx + dy * dy + dz * dz <= radius[lane] * radius[lane]) {
+      mask |= 1 << lane;
+    }
+  }
+  return mask;
+#endif
+}
+
+} // namespace
+
+LightClusterer::LightClusterer(JobSystem& jobs) :
+  jobs{jobs},
+  sliceData(slices) {}
+
+void LightClusterer::build(
+  const std::vector<PointLight>& lights,
+  const glm::mat4& projection,
+  float nearPlane,
+  float farPlane,
+  LightClusterData& data
+) {
+  this->nearPlane = nearPlane;
+  this->farPlane = farPlane;
+  inverseScaleX = 1.f / projection[0][0];
+  inverseScaleY = 1.f / projection[1][1];
+  const float logRatio{std::log(farPlane / nearPlane)};
+  data.sliceScale = static_cast<float>(slices) / logRatio;
+  data.sliceBias = -static_cast<float>(slices) * std::log(nearPlane) / logRatio;
+  data.lights.resize(lights.size() * 2);
+  for (std::size_t i{}; i < lights.size(); ++i) {
+    data.lights[i * 2] = glm::vec4{lights[i].position, lights[i].radius};
+    data.lights[i * 2 + 1] = glm::vec4{lights[i].color * lights[i].intensity, 0.f};
+  }
+  // Slices own disjoint clusters, so they need no synchronization.
+  jobs.parallelFor(slices, 1, [this, &lights](std::uint32_t begin, std::uint32_t end) {
+    for (std::uint32_t slice{begin}; slice < end; ++slice) {
+      binSlice(static_cast<int>(slice), lights);
+    }
+  });
+  data.clusters.resize(clusterCount * 2);
+  data.indices.clear();
+  for (int slice{}; slice < slices; ++slice) {
+    const Slice& bins{sliceData[slice]};
+    const std::uint32_t base{static_cast<std::uint32_t>(data.indices.size())};
+    data.indices.insert(data.indices.end(), bins.indices.begin(), bins.indices.end());
+    for (int cluster{}; cluster < sliceClusters; ++cluster) {
+      data.clusters[(slice * sliceClusters + cluster) * 2] = base + bins.clusters[cluster * 2];
+      data.clusters[(slice * sliceClusters + cluster) * 2 + 1] = bins.clusters[cluster * 2 + 1];
+    }
+  }
+}
+
+void LightClusterer::binSlice(int slice, const std::vector<PointLight>& lights) {
+  Slice& bins{sliceData[slice]};
+  const float depthNear{sliceDepth(slice, nearPlane, farPlane)};
+  const float depthFar{sliceDepth(slice + 1, nearPlane, farPlane)};
+  bins.x.clear();
+  bins.y.clear();
+  bins.z.clear();
+  bins.radius.clear();
+  bins.light.clear();
+  bins.indices.clear();
+  for (std::size_t i{}; i < lights.size(); ++i) {
+    const PointLight& light{lights[i]};
+    const float depth{-light.position.z};
+    if (depth + light.radius < depthNear || depth - light.radius > depthFar) {
+      continue;
+    }
+    bins.x.push_back(light.position.x);
+    bins.y.push_back(light.position.y);
+    bins.z.push_back(light.position.z);
+    bins.radius.push_back(light.radius);
+    bins.light.push_back(static_cast<std::uint32_t>(i));
+  }
+  const std::size_t candidates{bins.light.size()};
+  // Padding lanes are masked off below.
+  const std::size_t padded{(candidates + 3) & ~std::size_t{3}};
+  bins.x.resize(padded);
+  bins.y.resize(padded);
+  bins.z.resize(padded);
+  bins.radius.resize(padded);
+  for (int tileY{}; tileY < tilesY; ++tileY) {
+    const float ndcY0{-1.f + 2.f * static_cast<float>(tileY) / tilesY};
+    const float ndcY1{-1.f + 2.f * static_cast<float>(tileY + 1) / tilesY};
+    for (int tileX{}; tileX < tilesX; ++tileX) {
+      const float ndcX0{-1.f + 2.f * static_cast<float>(tileX) / tilesX};
+      const float ndcX1{-1.f + 2.f * static_cast<float>(tileX + 1) / tilesX};
+      // The froxel widens with depth, so its box spans both end planes.
+      const ClusterBox box{
+        glm::vec3{
+          std::min(ndcX0 * depthNear, ndcX0 * depthFar) * inverseScaleX,
+          std::min(ndcY0 * depthNear, ndcY0 * depthFar) * inverseScaleY,
+          -depthFar
+        },
+        glm::vec3{
+          std::max(ndcX1 * depthNear, ndcX1 * depthFar) * inverseScaleX,
+          std::max(ndcY1 * depthNear, ndcY1 * depthFar) * inverseScaleY,
+          -depthNear
+        }
+      };
+      const int cluster{tileY * tilesX + tileX};
+      bins.clusters[cluster * 2] = static_cast<std::uint32_t>(bins.indices.size());
+      for (std::size_t first{}; first < candidates; first += 4) {
+        int mask{testLights(&bins.x[first], &bins.y[first], &bins.z[first], &bins.radius[first], box)};
+        if (candidates - first < 4) {
+          mask &= (1 << (candidates - first)) - 1;
+        }
+        for (; mask != 0; mask &= mask - 1) {
+          int lane{};
+          while (!(mask & (1 << lane))) {
+            ++lane;
+          }
+          bins.indices.push_back(bins.light[first + static_cast<std::size_t>(lane)]);
+        }
+      }
+      bins.clusters[cluster * 2 + 1] = static_cast<std::uint32_t>(bins.indices.size()) - bins.clusters[cluster * 2];
+    }
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef LIGHT_CLUSTERS_HXX
+#define LIGHT_CLUSTERS_HXX
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "job_system.hxx"
+
+// A point light in view space.
+struct PointLight {
+  glm::vec3 position;
+  float radius;
+  glm::vec3 color;
+  float intensity;
+};
+
+// One frame of clustered lights, laid out as main.frag reads them from its
+// buffer textures.
+struct LightClusterData {
+  // Two texels per light: position and radius, then color times intensity.
+  std::vector<glm::vec4> lights{};
+  // Offset into indices and light count, per cluster. Clusters are ordered
+  // by depth slice, then tile row, then tile column.
+  std::vector<std::uint32_t> clusters{};
+  std::vector<std::uint32_t> indices{};
+  // slice = floor(log(viewDepth) * sliceScale + sliceBias)
+  float sliceScale{};
+  float sliceBias{};
+};
+
+// Assigns lights to a froxel grid: screen tiles in x and y and exponential
+// depth slices between the near and far planes, so per-pixel work depends
+// on the lights near the pixel rather than on the total. Slices are binned
+// in parallel on the job system; each cluster tests four lights at a time
+// against its view-space box.
+class LightClusterer {
+public:
+  static constexpr int tilesX{16};
+  static constexpr int tilesY{9};
+  static constexpr int slices{24};
+  static constexpr int clusterCount{tilesX * tilesY * slices};
+
+  explicit LightClusterer(JobSystem& jobs);
+
+  // Expects a symmetric perspective projection.
+  void build(
+    const std::vector<PointLight>& lights,
+    const glm::mat4& projection,
+    float nearPlane,
+    float farPlane,
+    LightClusterData& data
+  );
+
+private:
+  static constexpr int sliceClusters{tilesX * tilesY};
+
+  struct Slice {
+    // Lights overlapping the slice in depth, as a structure of arrays.
+    std::vector<float> x{};
+    std::vector<float> y{};
+    std::vector<float> z{};
+    std::vector<float> radius{};
+    std::vector<std::uint32_t> light{};
+    std::vector<std::uint32_t> indices{};
+    // Offset into indices and light count per cluster of the slice.
+    std::array<std::uint32_t, sliceClusters * 2> clusters{};
+  };
+
+  void binSlice(int slice, const std::vector<PointLight>& lights);
+
+  JobSystem& jobs;
+  std::vector<Slice> sliceData;
+  float nearPlane{};
+  float farPlane{};
+  // Inverses of the projection's x and y scale.
+  float inverseScaleX{};
+  float inverseScaleY{};
+};
+
+#endif // LIGHT_CLUSTERS_HXX
@@ -1,38 +1,50 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/gl.h>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
-#define QUOTE(x) #x
-#define STRING(x) QUOTE(x)
-#ifdef _DEBUG
-#define DEBUG
-#endif
-#ifdef DEBUG
-#define DEBUG_LOG(s) do { std::cout << s; } while (false);
-#define DEBUG_ERROR(s) do { std::cerr << s; } while (false);
-#define DEBUG_LOG_LINE(s) do { std::cout << s << '\n'; } while (false);
-#define DEBUG_ERROR_LINE(s) do { std::cerr << s << '\n'; } while (false);
-#define DEBUG_LOG_NEWLINE() do { std::cout << '\n'; } while (false);
-#define DEBUG_ERROR_NEWLINE() do { std::cerr << '\n'; } while (false);
-#else
-#define DEBUG_LOG(s)
-#define DEBUG_ERROR(s)
-#define DEBUG_LOG_LINE(s)
-#define DEBUG_ERROR_LINE(s)
-#define DEBUG_LOG_NEWLINE()
-#define DEBUG_ERROR_NEWLINE()
-#endif
+#include "allocation_tracker.hxx"
+#include "camera.hxx"
+#include "command_buffer.hxx"
+#include "debug.hxx"
+#include "dynamic_resolution.hxx"
+#include "frame_arena.hxx"
+#include "frame_exchange.hxx"
+#include "geometry_buffer.hxx"
+#include "gl_resources.hxx"
+#include "gpu_occlusion.hxx"
+#include "gpu_timer.hxx"
+#include "input.hxx"
+#include "job_system.hxx"
+#include "light_clusters.hxx"
+#include "mesh.hxx"
+#include "occlusion.hxx"
+#include "particles.hxx"
+#include "readback.hxx"
+#include "render_graph.hxx"
+#include "render_queue.hxx"
+#include "shader.hxx"
+#include "shadow_cascades.hxx"
+#include "stream_buffer.hxx"
+#include "texture_pool.hxx"
 
 #ifdef DEBUG
 void errorCallbackGLFW(int /*error*/, const char* description) {
@@ -52,31 +64,21 @@ void debugMessageCallbackGL(
 }
 #endif
 
-void keyCallback(GLFWwindow *window, int key, int /*scancode*/, int action, int mods) {
-  const int keyUp{action & GLFW_KEY_UP};
-  const bool keyQ{key == GLFW_KEY_Q};
-  const bool keyW{key == GLFW_KEY_W};
-  const bool keyF4{key == GLFW_KEY_F4};
-  const int keyCtrl{mods & GLFW_MOD_CONTROL};
-  const int keyAlt{mods & GLFW_MOD_ALT};
-  if (keyUp && ((keyCtrl && (keyQ || keyW)) || (keyAlt && keyF4))) {
-    glfwSetWindowShouldClose(window, true);
-    return;
-  }
-}
-
-std::string readFile(const char* const fileName) {
-  std::ifstream streamIn{fileName};
-  std::ostringstream streamOut{};
-  std::string s{};
-  while (std::getline(streamIn, s)) {
-    streamOut << s << '\n';
-  }
-  return streamOut.str();
-}
-
 constexpr std::tuple<int, int> windowSize{640, 480};
 constexpr std::tuple<int, int> versionOpenGL{3, 3};
+// Streamable resources are evicted above this estimate.
+constexpr std::uint64_t gpuMemoryBudget{512ull * 1024 * 1024};
+// With --allocation-test, frames after the warm-up must not allocate, and
+// the program exits on its own after the test frames.
+constexpr std::uint64_t allocationTestWarmupFrames{120};
+constexpr std::uint64_t allocationTestFrames{600};
+// The scene renders at a fraction of the framebuffer size chosen to keep GPU
+// frame time under the target, and is upscaled to it.
+constexpr DynamicResolutionSettings dynamicResolutionSettings{};
+constexpr std::size_t frameTimerScope{0};
+constexpr std::size_t depthPrePassTimerScope{1};
+constexpr std::size_t shadingTimerScope{2};
+constexpr std::size_t gpuTimerScopeCount{3};
 
 GLFWwindow* initializeWindow() {
   if (!glfwInit()) {
@@ -124,113 +126,1172 @@ GLFWwindow* initializeWindow() {
   DEBUG_LOG_LINE("C++ version: " << STRING(__cplusplus));
   DEBUG_LOG_LINE("Driver OpenGL version: " << glGetString(GL_VERSION));
   glfwSwapInterval(1);
-  glfwSetKeyCallback(window, keyCallback);
   return window;
 }
 
-GLuint createShader(GLenum type, const std::string& source) {
-  GLuint shader{glCreateShader(type)};
-  std::array<const char*, 1> sources{source.data()};
-  glShaderSource(shader, 1, sources.data(), nullptr /*length*/);
-  glCompileShader(shader);
-  return shader;
-}
+// Uniform block binding points and their std140 layouts in main.vert and
+// main.frag.
+constexpr GLuint frameBlockBinding{0};
+constexpr GLuint objectBlockBinding{1};
 
-GLuint createProgram(const std::string& vertexSource, const std::string& fragmentSource) {
-  GLuint vertexShader{createShader(GL_VERTEX_SHADER, vertexSource)};
-  GLuint fragmentShader{createShader(GL_FRAGMENT_SHADER, fragmentSource)};
-  GLuint program{glCreateProgram()};
-  glAttachShader(program, vertexShader);
-  glAttachShader(program, fragmentShader);
-  glLinkProgram(program);
-  GLint status{};
-  glGetProgramiv(program, GL_LINK_STATUS, &status);
-#ifdef DEBUG
-  if (!status) {
-    GLsizei programLogLength{};
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &programLogLength);
-    std::string programLog{};
-    programLog.resize(programLogLength);
-    glGetProgramInfoLog(program, programLogLength, &programLogLength, programLog.data());
-    DEBUG_ERROR_LINE("GL program error: " << programLog);
-    GLsizei vertexLogLength{};
-    glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &vertexLogLength);
-    if (vertexLogLength > 0) {
-      std::string vertexLog{};
-      vertexLog.resize(vertexLogLength);
-      glGetShaderInfoLog(vertexShader, vertexLogLength, &vertexLogLength, vertexLog.data());
-      DEBUG_ERROR_LINE("GL vertex shader error: " << vertexLog);
-    }
-    GLsizei fragmentLogLength{};
-    glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &fragmentLogLength);
-    if (fragmentLogLength > 0) {
-      std::string fragmentLog{};
-      fragmentLog.resize(fragmentLogLength);
-      glGetShaderInfoLog(fragmentShader, fragmentLogLength, &fragmentLogLength, fragmentLog.data());
-      DEBUG_ERROR_LINE("GL fragment shader error: " << fragmentLog);
-    }
-  }
-#endif
-  glDetachShader(program, vertexShader);
-  glDetachShader(program, fragmentShader);
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
-  if (!status) {
-    throw std::runtime_error{"Error creating GL program"};
-  }
-  return program;
-}
+struct FrameBlock {
+  glm::mat4 projection;
+  // xy: light tiles per pixel; z, w: depth slice scale and bias.
+  glm::vec4 clusterScale;
+  // Tiles in x and y and depth slices; w is unused.
+  glm::ivec4 clusterCounts;
+  // Texel offsets of the light, cluster and light index data in their
+  // buffer textures, and w 0 when they did not fit. Only known once the
+  // render thread has uploaded them.
+  glm::ivec4 lightOffsets;
+  // View space, towards the moon.
+  glm::vec4 moonDirection;
+  // View depth at the far end of each shadow cascade.
+  glm::vec4 shadowSplits;
+  // View space to shadow atlas coordinates and depth, per cascade.
+  std::array<glm::mat4, ShadowCascades::cascadeCount> shadowMatrices;
+};
+
+struct ObjectBlock {
+  glm::mat4 modelView;
+  glm::vec4 positionScale;
+  glm::vec4 positionOffset;
+  // x: albedo layer, or -1 for untextured; y: texture coordinate scale.
+  glm::vec4 material;
+};
+
+constexpr GLint albedoTextureUnit{0};
+constexpr GLint lightDataTextureUnit{1};
+constexpr GLint clusterDataTextureUnit{2};
+constexpr GLint lightIndicesTextureUnit{3};
+constexpr GLint shadowAtlasTextureUnit{4};
+
+// Textures are layers in the pool, so materials that only differ in their
+// textures still batch together.
+struct Material {
+  bool textured;
+  TextureLayer albedo;
+  float texCoordScale;
+};
+
+// Indices into ProgramData::meshes and ProgramData::materials.
+constexpr std::uint32_t triangleMesh{0};
+constexpr std::uint32_t terrainMesh{1};
+constexpr std::uint32_t checkerMaterial{0};
+constexpr std::uint32_t terrainMaterial{1};
 
 struct ProgramData {
-  GLuint program;
-  GLuint vao;
-  GLsizei vertexCount;
+  ProgramHandle program;
+  ProgramHandle proxyProgram;
+  ProgramHandle upscaleProgram;
+  ProgramHandle shadowProgram;
+  ProgramHandle particleUpdateProgram;
+  ProgramHandle particleProgram;
+  ProgramHandle depthProgram;
+  ProgramHandle overdrawProgram;
+  ProgramHandle heatMapProgram;
+  std::vector<GpuMesh> meshes;
+  std::vector<Material> materials;
 
   ProgramData() = delete;
-  ProgramData(GLuint program, GLuint vao, GLsizei vertexCount) :
-    program{program}, vao{vao}, vertexCount{vertexCount} {}
+  ProgramData(
+    ProgramHandle program,
+    ProgramHandle proxyProgram,
+    ProgramHandle upscaleProgram,
+    ProgramHandle shadowProgram,
+    ProgramHandle particleUpdateProgram,
+    ProgramHandle particleProgram,
+    ProgramHandle depthProgram,
+    ProgramHandle overdrawProgram,
+    ProgramHandle heatMapProgram,
+    std::vector<GpuMesh> meshes,
+    std::vector<Material> materials
+  ) :
+    program{program},
+    proxyProgram{proxyProgram},
+    upscaleProgram{upscaleProgram},
+    shadowProgram{shadowProgram},
+    particleUpdateProgram{particleUpdateProgram},
+    particleProgram{particleProgram},
+    depthProgram{depthProgram},
+    overdrawProgram{overdrawProgram},
+    heatMapProgram{heatMapProgram},
+    meshes{std::move(meshes)},
+    materials{std::move(materials)} {}
 };
 
-ProgramData initializeGL() {
+MeshData createTriangleMesh() {
+  MeshData triangle{};
+  triangle.positions = {glm::vec3{1.f, -1.f, 0.f}, glm::vec3{-1.f, -1.f, 0.f}, glm::vec3{0.f, 1.f, 0.f}};
+  triangle.colors = {glm::vec4{1.f, 0.f, 0.f, 1.f}, glm::vec4{0.f, 1.f, 0.f, 1.f}, glm::vec4{0.f, 0.f, 1.f, 1.f}};
+  triangle.texCoords = {glm::vec2{1.f, 0.f}, glm::vec2{0.f, 0.f}, glm::vec2{.5f, 1.f}};
+  triangle.indices = {0, 1, 2};
+  return triangle;
+}
+
+// RGBA8 textures generated at startup until there is an image loader.
+constexpr int textureSize{256};
+
+std::vector<std::uint8_t> createCheckerTexture() {
+  constexpr int checkerSize{32};
+  std::vector<std::uint8_t> pixels(textureSize * textureSize * 4);
+  for (int y{}; y < textureSize; ++y) {
+    for (int x{}; x < textureSize; ++x) {
+      const std::uint8_t value{((x / checkerSize + y / checkerSize) % 2) ? std::uint8_t{255} : std::uint8_t{160}};
+      std::fill_n(pixels.begin() + (y * textureSize + x) * 4, 3, value);
+      pixels[(y * textureSize + x) * 4 + 3] = 255;
+    }
+  }
+  return pixels;
+}
+
+std::vector<std::uint8_t> createDetailTexture() {
+  std::vector<std::uint8_t> pixels(textureSize * textureSize * 4);
+  std::uint32_t state{0x9e3779b9u};
+  for (std::size_t pixel{}; pixel < pixels.size() / 4; ++pixel) {
+    // xorshift32 grain, kept bright so it only modulates the vertex colors.
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    const std::uint8_t value{static_cast<std::uint8_t>(200 + state % 56)};
+    std::fill_n(pixels.begin() + pixel * 4, 3, value);
+    pixels[pixel * 4 + 3] = 255;
+  }
+  return pixels;
+}
+
+ProgramData initializeGL(JobSystem& jobs, GLResources& resources, GeometryBuffer& geometry, TexturePool& textures) {
   // TODO: Implement std::filesystem calls to check for shader file existence.
   std::string vertexSource{readFile("res/shaders/main.vert")};
   std::string fragmentSource{readFile("res/shaders/main.frag")};
-  GLuint program{createProgram(vertexSource, fragmentSource)};
-  GLuint vao{};
-  glGenVertexArrays(1, &vao);
-  return ProgramData{program, vao, 3};
-}
-
-void mainLoop(GLFWwindow* window, const ProgramData& programData) {
-  while (!glfwWindowShouldClose(window)) {
-    int width{};
-    int height{};
-    glfwGetFramebufferSize(window, &width, &height);
-    glViewport(0, 0, width, height);
-    glClearColor(0.f, .5f, 1.f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(programData.program);
-    // OpenGL Core (3.2+) requires explicit binding of a VAO before drawing,
-    // even if no vertex data is being provided to the shaders.
-    glBindVertexArray(programData.vao);
-    glDrawArrays(GL_TRIANGLES, 0, programData.vertexCount);
-    glfwSwapBuffers(window);
+  ProgramHandle program{resources.createProgram(vertexSource, fragmentSource)};
+  const GLuint programName{resources.get(program)};
+  glUniformBlockBinding(programName, glGetUniformBlockIndex(programName, "FrameBlock"), frameBlockBinding);
+  glUniformBlockBinding(programName, glGetUniformBlockIndex(programName, "ObjectBlock"), objectBlockBinding);
+  glUseProgram(programName);
+  glUniform1i(glGetUniformLocation(programName, "albedoTextures"), albedoTextureUnit);
+  glUniform1i(glGetUniformLocation(programName, "lightData"), lightDataTextureUnit);
+  glUniform1i(glGetUniformLocation(programName, "clusterData"), clusterDataTextureUnit);
+  glUniform1i(glGetUniformLocation(programName, "lightIndices"), lightIndicesTextureUnit);
+  glUniform1i(glGetUniformLocation(programName, "shadowAtlas"), shadowAtlasTextureUnit);
+  glUseProgram(0);
+  std::vector<GpuMesh> meshes{};
+  meshes.push_back(uploadMesh(geometry, importMesh(createTriangleMesh())));
+  meshes.push_back(uploadMesh(geometry, importMesh(generateTerrain(jobs, 256, 512.f, 24.f))));
+  std::string proxyVertexSource{readFile("res/shaders/proxy.vert")};
+  std::string proxyFragmentSource{readFile("res/shaders/proxy.frag")};
+  ProgramHandle proxyProgram{resources.createProgram(proxyVertexSource, proxyFragmentSource)};
+  std::string upscaleVertexSource{readFile("res/shaders/upscale.vert")};
+  std::string upscaleFragmentSource{readFile("res/shaders/upscale.frag")};
+  ProgramHandle upscaleProgram{resources.createProgram(upscaleVertexSource, upscaleFragmentSource)};
+  glUseProgram(resources.get(upscaleProgram));
+  glUniform1i(glGetUniformLocation(resources.get(upscaleProgram), "sceneColor"), 0);
+  glUseProgram(0);
+  std::string shadowVertexSource{readFile("res/shaders/shadow.vert")};
+  std::string shadowFragmentSource{readFile("res/shaders/shadow.frag")};
+  ProgramHandle shadowProgram{resources.createProgram(shadowVertexSource, shadowFragmentSource)};
+  const GLuint shadowProgramName{resources.get(shadowProgram)};
+  glUniformBlockBinding(shadowProgramName, glGetUniformBlockIndex(shadowProgramName, "ObjectBlock"), objectBlockBinding);
+  std::string particleUpdateSource{readFile("res/shaders/particles_update.vert")};
+  ProgramHandle particleUpdateProgram{
+    resources.adoptProgram(createTransformFeedbackProgram(particleUpdateSource, ParticleSystem::feedbackVaryings))
+  };
+  std::string particleVertexSource{readFile("res/shaders/particles.vert")};
+  std::string particleFragmentSource{readFile("res/shaders/particles.frag")};
+  ProgramHandle particleProgram{resources.createProgram(particleVertexSource, particleFragmentSource)};
+  // The depth pre-pass and the overdraw count replay the scene's draws, so
+  // they share its uniform blocks and, for GL_EQUAL, its exact positions.
+  std::string depthVertexSource{readFile("res/shaders/depth.vert")};
+  std::string depthFragmentSource{readFile("res/shaders/depth.frag")};
+  std::string overdrawFragmentSource{readFile("res/shaders/overdraw.frag")};
+  ProgramHandle depthProgram{resources.createProgram(depthVertexSource, depthFragmentSource)};
+  ProgramHandle overdrawProgram{resources.createProgram(depthVertexSource, overdrawFragmentSource)};
+  for (const ProgramHandle replayProgram : {depthProgram, overdrawProgram}) {
+    const GLuint replayProgramName{resources.get(replayProgram)};
+    glUniformBlockBinding(replayProgramName, glGetUniformBlockIndex(replayProgramName, "FrameBlock"), frameBlockBinding);
+    glUniformBlockBinding(replayProgramName, glGetUniformBlockIndex(replayProgramName, "ObjectBlock"), objectBlockBinding);
+  }
+  std::string heatMapFragmentSource{readFile("res/shaders/heat_map.frag")};
+  ProgramHandle heatMapProgram{resources.createProgram(upscaleVertexSource, heatMapFragmentSource)};
+  glUseProgram(resources.get(heatMapProgram));
+  glUniform1i(glGetUniformLocation(resources.get(heatMapProgram), "overdraw"), 0);
+  glUseProgram(0);
+  constexpr TextureFormat albedoFormat{GL_RGBA8, textureSize, textureSize, 9};
+  std::vector<Material> materials{};
+  materials.push_back(Material{true, textures.allocate(albedoFormat), 1.f});
+  textures.upload(materials[checkerMaterial].albedo, GL_RGBA, GL_UNSIGNED_BYTE, createCheckerTexture().data());
+  materials.push_back(Material{true, textures.allocate(albedoFormat), 64.f});
+  textures.upload(materials[terrainMaterial].albedo, GL_RGBA, GL_UNSIGNED_BYTE, createDetailTexture().data());
+  textures.generateMipmaps();
+  return ProgramData{
+    program,
+    proxyProgram,
+    upscaleProgram,
+    shadowProgram,
+    particleUpdateProgram,
+    particleProgram,
+    depthProgram,
+    overdrawProgram,
+    heatMapProgram,
+    std::move(meshes),
+    std::move(materials)
+  };
+}
+
+struct SceneObject {
+  glm::dvec3 position;
+  std::uint32_t mesh;
+  std::uint32_t material;
+  std::uint32_t occlusionObject;
+  // Movable objects are never left in a cached shadow cascade.
+  bool movable;
+};
+
+// Bobs up and down around its position.
+struct SceneLight {
+  glm::dvec3 position;
+  float radius;
+  glm::vec3 color;
+  float phase;
+};
+
+std::vector<SceneLight> createSceneLights() {
+  constexpr int lightCount{2048};
+  std::vector<SceneLight> lights{};
+  lights.reserve(lightCount);
+  std::uint32_t state{0x2545f491u};
+  const auto random{[&state]() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<float>(state) / 4294967296.f;
+  }};
+  // Scattered just above the terrain.
+  for (int i{}; i < lightCount; ++i) {
+    const glm::dvec3 position{(random() - .5f) * 480.f, -28.f + random() * 26.f, (random() - .5f) * 480.f};
+    const glm::vec3 color{glm::normalize(glm::vec3{random(), random(), random()} + .1f)};
+    lights.push_back(SceneLight{position, 6.f + random() * 12.f, color, random() * 6.2831853f});
+  }
+  return lights;
+}
+
+// A visible object, as decided by the main thread.
+struct DrawItem {
+  ObjectBlock objectBlock;
+  std::uint32_t mesh;
+  std::uint32_t material;
+  std::uint32_t occlusionObject;
+};
+
+// Render modes toggled at runtime.
+struct RenderOptions {
+  // Lays down depth first, so the shading pass runs once per pixel.
+  bool depthPrePass{};
+  // Shows how often each pixel is shaded instead of the scene.
+  bool overdrawHeatMap{};
+};
+
+// Everything the render thread needs for one frame. The main thread does not
+// touch a packet again until the render thread has released it.
+struct FramePacket {
+  // Framebuffer size.
+  int width;
+  int height;
+  // Size the scene is rendered at, in the corner of full-size targets.
+  int sceneWidth;
+  int sceneHeight;
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  FrameBlock frameBlock{};
+  LightClusterData lights{};
+  // Payloads index draws.
+  RenderQueue renderQueue{};
+  std::vector<DrawItem> draws{};
+  // Indexed by GPU occlusion object.
+  std::vector<BoundingBox> relativeBounds{};
+  // The frame block, then one object block per queued draw, each at the
+  // uniform buffer offset alignment. Uploaded with a single copy.
+  std::vector<std::byte> uniformData{};
+  // Recorded in parallel from consecutive ranges of the render queue and
+  // replayed in order.
+  std::vector<CommandBuffer> commandBuffers{};
+  std::array<ShadowCascade, ShadowCascades::cascadeCount> shadowCascades{};
+  // Casters of each cascade drawn this frame; empty for cached cascades.
+  std::array<CommandBuffer, ShadowCascades::cascadeCount> shadowCommands{};
+  ParticleBlock particleBlock{};
+  RenderOptions options{};
+  // Read the finished frame back for a screenshot.
+  bool capture{};
+  bool logGpuTimings{};
+};
+
+// Buffer textures over one stream buffer, from which main.frag reads the
+// clustered lights.
+struct LightBuffers {
+  StreamBuffer& stream;
+  TextureHandle lights;
+  TextureHandle clusters;
+  TextureHandle indices;
+};
+
+TextureHandle createBufferTexture(GLResources& resources, GLenum internalFormat, GLuint buffer) {
+  const TextureHandle texture{resources.createTexture()};
+  glBindTexture(GL_TEXTURE_BUFFER, resources.get(texture));
+  glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  return texture;
+}
+
+// Buffer texture ranges need GL 4.3, so the textures cover the whole stream
+// buffer and the shader adds the returned texel offsets. w is 0 when the
+// data did not fit.
+glm::ivec4 uploadLights(StreamBuffer& stream, const LightClusterData& data) {
+  constexpr GLsizeiptr alignment{16};
+  const auto upload{[&stream](const auto& source) {
+    const GLsizeiptr size{static_cast<GLsizeiptr>(source.size() * sizeof(source[0]))};
+    const StreamBuffer::Allocation allocation{stream.allocate(size, alignment)};
+    if (allocation.data) {
+      std::memcpy(allocation.data, source.data(), static_cast<std::size_t>(size));
+    }
+    return allocation;
+  }};
+  const StreamBuffer::Allocation lights{upload(data.lights)};
+  const StreamBuffer::Allocation clusters{upload(data.clusters)};
+  const StreamBuffer::Allocation indices{upload(data.indices)};
+  if (!lights.data || !clusters.data || !indices.data) {
+    return glm::ivec4{0};
+  }
+  return glm::ivec4{
+    static_cast<int>(lights.offset / sizeof(glm::vec4)),
+    static_cast<int>(clusters.offset / (2 * sizeof(std::uint32_t))),
+    static_cast<int>(indices.offset / sizeof(std::uint32_t)),
+    1
+  };
+}
+
+// State used only by the render thread while the main loop runs.
+struct RenderContext {
+  GLResources& resources;
+  GpuOcclusionCuller& gpuOcclusionCuller;
+  StreamBuffer& uniformStream;
+  GLint uniformAlignment;
+  LightBuffers& lightBuffers;
+  FramebufferReadback& readback;
+  RenderGraph& renderGraph;
+  GpuTimer& gpuTimer;
+  // Written by the render thread whenever a frame's GPU time is known, and
+  // taken by the main thread; negative when there is nothing new.
+  std::atomic<float>& gpuFrameMilliseconds;
+  GLuint upscaleProgram;
+  GLint upscaleRegionLocation;
+  GLuint emptyVertexArray;
+  const ShadowAtlas& shadowAtlas;
+  ParticleSystem& particleSystem;
+  GLuint depthProgram;
+  GLuint overdrawProgram;
+  GLuint heatMapProgram;
+};
+
+// Runs on the render thread, which owns the GL context. Draws were recorded
+// by the main thread and its workers; only their replay happens here.
+void renderFrame(GLFWwindow* window, RenderContext& context, const FramePacket& packet) {
+  GLResources& resources{context.resources};
+  resources.collect();
+  resources.memory().beginFrame();
+  context.readback.poll();
+  context.uniformStream.beginFrame();
+  context.lightBuffers.stream.beginFrame();
+  context.gpuOcclusionCuller.beginFrame();
+  if (context.gpuTimer.beginFrame()) {
+    context.gpuFrameMilliseconds.store(context.gpuTimer.milliseconds(frameTimerScope));
+  }
+  if (packet.logGpuTimings) {
+    DEBUG_LOG_LINE(
+      "GPU time: frame " << context.gpuTimer.milliseconds(frameTimerScope) << " ms"
+      << ", depth pre-pass " << context.gpuTimer.milliseconds(depthPrePassTimerScope) << " ms"
+      << ", shading " << context.gpuTimer.milliseconds(shadingTimerScope) << " ms"
+    );
+  }
+  const StreamBuffer::Allocation uniforms{context.uniformStream.allocate(
+    static_cast<GLsizeiptr>(packet.uniformData.size()),
+    context.uniformAlignment
+  )};
+  const StreamBuffer::Allocation particleUniforms{context.uniformStream.allocate(
+    static_cast<GLsizeiptr>(sizeof(ParticleBlock)),
+    context.uniformAlignment
+  )};
+  if (particleUniforms.data) {
+    std::memcpy(particleUniforms.data, &packet.particleBlock, sizeof(ParticleBlock));
+  }
+  const glm::ivec4 lightOffsets{uploadLights(context.lightBuffers.stream, packet.lights)};
+  context.lightBuffers.stream.commit();
+  if (uniforms.data) {
+    std::memcpy(uniforms.data, packet.uniformData.data(), packet.uniformData.size());
+    std::memcpy(
+      static_cast<std::byte*>(uniforms.data) + offsetof(FrameBlock, lightOffsets),
+      &lightOffsets,
+      sizeof(lightOffsets)
+    );
+  }
+  context.uniformStream.commit();
+  // Cached cascades keep what an earlier frame drew into their part of the
+  // atlas; only the others are cleared and drawn.
+  const auto shadowPass{[&context, &packet, &uniforms](const RenderGraph&) {
+    if (!uniforms.data) {
+      return;
+    }
+    glEnable(GL_DEPTH_TEST);
+    // Casters between the light and a cascade's near plane are flattened
+    // onto it rather than clipped.
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.f, 4.f);
+    glEnable(GL_SCISSOR_TEST);
+    const CommandContext commandContext{
+      context.resources,
+      context.gpuOcclusionCuller,
+      context.uniformStream.buffer(),
+      uniforms.offset
+    };
+    for (int cascade{}; cascade < ShadowCascades::cascadeCount; ++cascade) {
+      if (!packet.shadowCascades[cascade].render) {
+        continue;
+      }
+      GLint x{};
+      GLint y{};
+      ShadowCascades::viewport(cascade, x, y);
+      glViewport(x, y, ShadowCascades::mapSize, ShadowCascades::mapSize);
+      glScissor(x, y, ShadowCascades::mapSize, ShadowCascades::mapSize);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      executeCommandBuffer(packet.shadowCommands[cascade], commandContext);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_DEPTH_TEST);
+  }};
+  RenderGraph::Resource shadowAtlas{};
+  // Binds what every replay of the scene's draws reads.
+  const auto bindSceneInputs{[&context, &uniforms, &shadowAtlas](const RenderGraph& graph) {
+    glBindBufferRange(
+      GL_UNIFORM_BUFFER,
+      frameBlockBinding,
+      context.uniformStream.buffer(),
+      uniforms.offset,
+      sizeof(FrameBlock)
+    );
+    const LightBuffers& lightBuffers{context.lightBuffers};
+    glActiveTexture(GL_TEXTURE0 + lightDataTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, context.resources.get(lightBuffers.lights));
+    glActiveTexture(GL_TEXTURE0 + clusterDataTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, context.resources.get(lightBuffers.clusters));
+    glActiveTexture(GL_TEXTURE0 + lightIndicesTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, context.resources.get(lightBuffers.indices));
+    glActiveTexture(GL_TEXTURE0 + shadowAtlasTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, graph.texture(shadowAtlas));
+  }};
+  const auto replayScene{[&context, &packet, &uniforms](GLuint programOverride) {
+    const CommandContext commandContext{
+      context.resources,
+      context.gpuOcclusionCuller,
+      context.uniformStream.buffer(),
+      uniforms.offset,
+      programOverride
+    };
+    for (const CommandBuffer& commands : packet.commandBuffers) {
+      executeCommandBuffer(commands, commandContext);
+    }
+  }};
+  const auto depthPrePass{[&context, &packet, &uniforms, &bindSceneInputs, &replayScene](const RenderGraph& graph) {
+    glViewport(0, 0, packet.sceneWidth, packet.sceneHeight);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    if (!uniforms.data) {
+      return;
+    }
+    bindSceneInputs(graph);
+    context.gpuTimer.begin(depthPrePassTimerScope);
+    glEnable(GL_DEPTH_TEST);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    replayScene(context.depthProgram);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+    context.gpuTimer.end(depthPrePassTimerScope);
+  }};
+  // Shades the scene, or counts how often each pixel would be shaded. After
+  // a depth pre-pass only the fragments that won it pass GL_EQUAL.
+  const auto scenePass{[&context, &packet, &uniforms, &bindSceneInputs, &replayScene](const RenderGraph& graph) {
+    const RenderOptions& options{packet.options};
+    glViewport(0, 0, packet.sceneWidth, packet.sceneHeight);
+    if (options.overdrawHeatMap) {
+      glClearColor(0.f, 0.f, 0.f, 0.f);
+    } else {
+      glClearColor(0.f, .5f, 1.f, 1.f);
+    }
+    glClear(options.depthPrePass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Without its uniforms the frame only clears.
+    if (!uniforms.data) {
+      return;
+    }
+    bindSceneInputs(graph);
+    context.gpuTimer.begin(shadingTimerScope);
+    glEnable(GL_DEPTH_TEST);
+    if (options.depthPrePass) {
+      glDepthFunc(GL_EQUAL);
+      glDepthMask(GL_FALSE);
+    }
+    if (options.overdrawHeatMap) {
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_ONE, GL_ONE);
+    }
+    replayScene(options.overdrawHeatMap ? context.overdrawProgram : 0);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_DEPTH_TEST);
+    context.gpuTimer.end(shadingTimerScope);
+  }};
+  RenderGraph::Resource overdraw{};
+  const auto heatMapPass{[&context, &packet, &overdraw](const RenderGraph& graph) {
+    glViewport(0, 0, packet.sceneWidth, packet.sceneHeight);
+    glUseProgram(context.heatMapProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graph.texture(overdraw));
+    glBindVertexArray(context.emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+  }};
+  const auto occlusionPass{[&context, &packet](const RenderGraph&) {
+    glViewport(0, 0, packet.sceneWidth, packet.sceneHeight);
+    context.gpuOcclusionCuller.queryObjects(packet.viewProjection, packet.relativeBounds);
+  }};
+  const auto particleUpdatePass{[&context, &particleUniforms](const RenderGraph&) {
+    if (!particleUniforms.data) {
+      return;
+    }
+    glBindBufferRange(
+      GL_UNIFORM_BUFFER,
+      ParticleSystem::blockBinding,
+      context.uniformStream.buffer(),
+      particleUniforms.offset,
+      sizeof(ParticleBlock)
+    );
+    context.particleSystem.update();
+  }};
+  const auto particlePass{[&context, &packet](const RenderGraph&) {
+    glViewport(0, 0, packet.sceneWidth, packet.sceneHeight);
+    context.particleSystem.draw(packet.view, packet.projection);
+  }};
+  RenderGraph::Resource sceneColor{};
+  const auto upscalePass{[&context, &packet, &sceneColor](const RenderGraph& graph) {
+    const float width{static_cast<float>(packet.width)};
+    const float height{static_cast<float>(packet.height)};
+    const float sceneWidth{static_cast<float>(packet.sceneWidth)};
+    const float sceneHeight{static_cast<float>(packet.sceneHeight)};
+    glUseProgram(context.upscaleProgram);
+    glUniform4f(
+      context.upscaleRegionLocation,
+      sceneWidth / width,
+      sceneHeight / height,
+      (sceneWidth - .5f) / width,
+      (sceneHeight - .5f) / height
+    );
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graph.texture(sceneColor));
+    glBindVertexArray(context.emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+  }};
+  const auto readbackPass{[&context, &packet](const RenderGraph&) {
+    context.readback.request(packet.width, packet.height);
+  }};
+  // A minimized window has nothing to draw into.
+  if (packet.width > 0 && packet.height > 0) {
+    RenderGraph& graph{context.renderGraph};
+    graph.reset();
+    const RenderGraph::Resource backbuffer{graph.importBackbuffer(packet.width, packet.height)};
+    shadowAtlas = graph.importTexture("shadow atlas", context.shadowAtlas.texture(), context.shadowAtlas.desc());
+    const bool drawShadows{std::any_of(
+      packet.shadowCascades.begin(),
+      packet.shadowCascades.end(),
+      [](const ShadowCascade& cascade) { return cascade.render; }
+    )};
+    if (drawShadows) {
+      graph.addPass("shadows", shadowPass).depthAttachment(shadowAtlas);
+    }
+    // Scene targets stay at the full framebuffer size and the scene is drawn
+    // into their corner, so changing the scale never reallocates them.
+    sceneColor = graph.createTarget("scene color", RenderTargetDesc{GL_RGBA8, packet.width, packet.height});
+    const RenderGraph::Resource sceneDepth{
+      graph.createTarget("scene depth", RenderTargetDesc{GL_DEPTH_COMPONENT24, packet.width, packet.height})
+    };
+    if (packet.options.depthPrePass) {
+      graph.addPass("depth pre-pass", depthPrePass).depthAttachment(sceneDepth);
+    }
+    if (packet.options.overdrawHeatMap) {
+      overdraw = graph.createTarget("overdraw", RenderTargetDesc{GL_R16F, packet.width, packet.height});
+      graph.addPass("overdraw", scenePass).colorAttachment(overdraw).depthAttachment(sceneDepth);
+      graph.addPass("overdraw heat map", heatMapPass).read(overdraw).colorAttachment(sceneColor);
+    } else {
+      graph.addPass("scene", scenePass).read(shadowAtlas).colorAttachment(sceneColor).depthAttachment(sceneDepth);
+    }
+    graph.addPass("occlusion queries", occlusionPass).depthAttachment(sceneDepth).sideEffect();
+    // The update writes only GL buffers, which the graph does not track.
+    graph.addPass("particle update", particleUpdatePass).sideEffect();
+    // Left out of the heat map, which only counts the scene's draws.
+    if (!packet.options.overdrawHeatMap) {
+      graph.addPass("particles", particlePass).colorAttachment(sceneColor).depthAttachment(sceneDepth);
+    }
+    graph.addPass("upscale", upscalePass).read(sceneColor).colorAttachment(backbuffer);
+    if (packet.capture) {
+      graph.addPass("readback", readbackPass).read(backbuffer).sideEffect();
+    }
+    graph.compile();
+    context.gpuTimer.begin(frameTimerScope);
+    graph.execute();
+    context.gpuTimer.end(frameTimerScope);
+  }
+  context.uniformStream.endFrame();
+  context.lightBuffers.stream.endFrame();
+  resources.endFrame();
+  glfwSwapBuffers(window);
+}
+
+void handleWindowKeys(GLFWwindow* window, const InputState& input) {
+  const bool keyCtrl{(input.modifiers() & GLFW_MOD_CONTROL) != 0};
+  const bool keyAlt{(input.modifiers() & GLFW_MOD_ALT) != 0};
+  if ((keyCtrl && (input.keyPressed(GLFW_KEY_Q) || input.keyPressed(GLFW_KEY_W)))
+      || (keyAlt && input.keyPressed(GLFW_KEY_F4))) {
+    glfwSetWindowShouldClose(window, true);
+  }
+}
+
+void handleRenderKeys(const InputState& input, RenderOptions& options) {
+  if (input.keyPressed(GLFW_KEY_F2)) {
+    options.depthPrePass = !options.depthPrePass;
+    DEBUG_LOG_LINE("Depth pre-pass " << (options.depthPrePass ? "on" : "off"));
+  }
+  if (input.keyPressed(GLFW_KEY_F3)) {
+    options.overdrawHeatMap = !options.overdrawHeatMap;
+    DEBUG_LOG_LINE("Overdraw heat map " << (options.overdrawHeatMap ? "on" : "off"));
+  }
+}
+
+void updateCamera(const InputState& input, Camera& camera, double deltaTime) {
+  constexpr double moveSpeed{50.};
+  constexpr double boostFactor{20.};
+  constexpr double turnSpeed{1.5};
+  constexpr double pitchLimit{1.55};
+  const auto pressed{[&input](int key) { return static_cast<int>(input.keyDown(key)); }};
+  camera.yaw += turnSpeed * deltaTime * (pressed(GLFW_KEY_RIGHT) - pressed(GLFW_KEY_LEFT));
+  camera.pitch += turnSpeed * deltaTime * (pressed(GLFW_KEY_UP) - pressed(GLFW_KEY_DOWN));
+  camera.pitch = glm::clamp(camera.pitch, -pitchLimit, pitchLimit);
+  const double speed{moveSpeed * (pressed(GLFW_KEY_LEFT_SHIFT) ? boostFactor : 1.) * deltaTime};
+  camera.position += camera.forward() * (speed * (pressed(GLFW_KEY_W) - pressed(GLFW_KEY_S)));
+  camera.position += camera.right() * (speed * (pressed(GLFW_KEY_D) - pressed(GLFW_KEY_A)));
+}
+
+// Culls the scene and fills the packet's sorted render queue.
+void buildFramePacket(
+  FramePacket& packet,
+  const Camera& camera,
+  OcclusionCuller& occlusionCuller,
+  const std::vector<SceneObject>& sceneObjects,
+  const GeometryBuffer& geometry,
+  const ProgramData& programData
+) {
+  // Culling runs in camera-relative space, like everything sent to the GPU.
+  const float aspectRatio{
+    packet.height > 0 ? static_cast<float>(packet.width) / static_cast<float>(packet.height) : 1.f
+  };
+  packet.view = camera.rotation();
+  packet.projection = camera.projection(aspectRatio);
+  packet.viewProjection = packet.projection * packet.view;
+  packet.renderQueue.clear();
+  packet.renderQueue.reserve(sceneObjects.size());
+  packet.draws.clear();
+  packet.draws.reserve(sceneObjects.size());
+  packet.relativeBounds.resize(sceneObjects.size());
+  {
+    const AllocationScope cullingScope{"culling"};
+    occlusionCuller.render(packet.viewProjection);
+  }
+  for (std::size_t i{}; i < sceneObjects.size(); ++i) {
+    const SceneObject& object{sceneObjects[i]};
+    const GpuMesh& mesh{programData.meshes[object.mesh]};
+    const Material& material{programData.materials[object.material]};
+    packet.relativeBounds[object.occlusionObject] = camera.relativeBounds(object.position, mesh.bounds);
+    if (!occlusionCuller.isVisible(packet.relativeBounds[object.occlusionObject])) {
+      continue;
+    }
+    const glm::mat4 modelView{camera.modelView(object.position)};
+    DrawKeyFields keyFields{};
+    keyFields.program = programData.program.index;
+    keyFields.vao = geometry.vertexArray(mesh.geometry.pool).index;
+    // Sorting by texture array rather than by material lets draws that only
+    // differ in their texture layer share the binding.
+    keyFields.material = material.textured ? material.albedo.array + 1 : 0;
+    keyFields.depth = -modelView[3].z / camera.farPlane;
+    packet.renderQueue.submit(makeDrawKey(keyFields), static_cast<std::uint32_t>(packet.draws.size()));
+    packet.draws.push_back(DrawItem{
+      ObjectBlock{
+        modelView,
+        glm::vec4{mesh.positionScale, 0.f},
+        glm::vec4{mesh.positionOffset, 0.f},
+        glm::vec4{material.textured ? static_cast<float>(material.albedo.layer) : -1.f, material.texCoordScale, 0.f, 0.f}
+      },
+      object.mesh,
+      object.material,
+      object.occlusionObject
+    });
+  }
+  packet.renderQueue.sort();
+}
+
+// World space, towards the moon.
+glm::dvec3 moonDirection() {
+  return glm::normalize(glm::dvec3{.3, 1., .2});
+}
+
+// Moves the lights into view space and bins them into clusters for the
+// packet's projection.
+void buildLightClusters(
+  FramePacket& packet,
+  const Camera& camera,
+  LightClusterer& lightClusterer,
+  const std::vector<SceneLight>& sceneLights,
+  double time,
+  std::vector<PointLight>& viewLights
+) {
+  constexpr float bobHeight{2.f};
+  constexpr float lightIntensity{40.f};
+  const glm::mat3 rotation{camera.rotation()};
+  viewLights.clear();
+  for (const SceneLight& light : sceneLights) {
+    const glm::dvec3 position{light.position + glm::dvec3{0., bobHeight * std::sin(time + light.phase), 0.}};
+    viewLights.push_back(PointLight{rotation * camera.relativePosition(position), light.radius, light.color, lightIntensity});
+  }
+  {
+    const AllocationScope lightScope{"light binning"};
+    lightClusterer.build(viewLights, packet.projection, camera.nearPlane, camera.farPlane, packet.lights);
+  }
+  packet.frameBlock = FrameBlock{
+    packet.projection,
+    glm::vec4{
+      static_cast<float>(LightClusterer::tilesX) / static_cast<float>(packet.sceneWidth),
+      static_cast<float>(LightClusterer::tilesY) / static_cast<float>(packet.sceneHeight),
+      packet.lights.sliceScale,
+      packet.lights.sliceBias
+    },
+    glm::ivec4{LightClusterer::tilesX, LightClusterer::tilesY, LightClusterer::slices, 0},
+    glm::ivec4{0},
+    glm::vec4{rotation * glm::vec3{moonDirection()}, 0.f},
+    // Filled in by buildShadowCascades.
+    glm::vec4{0.f},
+    {}
+  };
+}
+
+// Draws per command buffer, and so per recording job.
+constexpr std::uint32_t drawsPerCommandBuffer{64};
+
+GLintptr alignUniformOffset(GLintptr offset, GLint alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Lays out the packet's uniform data and records its sorted draws into
+// command buffers, one range of the render queue per job.
+void recordCommands(
+  JobSystem& jobs,
+  FramePacket& packet,
+  const GeometryBuffer& geometry,
+  const TexturePool& textures,
+  const ProgramData& programData,
+  GLint uniformAlignment
+) {
+  const auto& items{packet.renderQueue.items()};
+  const std::uint32_t itemCount{static_cast<std::uint32_t>(items.size())};
+  const GLintptr objectsOffset{alignUniformOffset(sizeof(FrameBlock), uniformAlignment)};
+  const GLintptr objectStride{alignUniformOffset(sizeof(ObjectBlock), uniformAlignment)};
+  packet.uniformData.resize(static_cast<std::size_t>(objectsOffset + objectStride * itemCount));
+  std::memcpy(packet.uniformData.data(), &packet.frameBlock, sizeof(packet.frameBlock));
+  const std::uint32_t bufferCount{(itemCount + drawsPerCommandBuffer - 1) / drawsPerCommandBuffer};
+  packet.commandBuffers.resize(bufferCount);
+  // Each job writes only its own buffer and its own object blocks.
+  jobs.parallelFor(bufferCount, 1, [&](std::uint32_t begin, std::uint32_t end) {
+    for (std::uint32_t buffer{begin}; buffer < end; ++buffer) {
+      CommandBuffer& commands{packet.commandBuffers[buffer]};
+      commands.clear();
+      const std::uint32_t last{std::min(itemCount, (buffer + 1) * drawsPerCommandBuffer)};
+      for (std::uint32_t item{buffer * drawsPerCommandBuffer}; item < last; ++item) {
+        const DrawItem& draw{packet.draws[items[item].payload]};
+        const GpuMesh& mesh{programData.meshes[draw.mesh]};
+        const Material& material{programData.materials[draw.material]};
+        const GLintptr objectOffset{objectsOffset + objectStride * item};
+        std::memcpy(packet.uniformData.data() + objectOffset, &draw.objectBlock, sizeof(ObjectBlock));
+        commands.bindProgram(programData.program);
+        commands.bindVertexArray(geometry.vertexArray(mesh.geometry.pool));
+        if (material.textured) {
+          commands.bindTexture(albedoTextureUnit, GL_TEXTURE_2D_ARRAY, textures.texture(material.albedo.array));
+        }
+        commands.bindUniforms(objectBlockBinding, objectOffset, sizeof(ObjectBlock));
+        commands.beginConditionalRender(draw.occlusionObject);
+        commands.drawIndexed(
+          GL_TRIANGLES,
+          mesh.indexCount,
+          mesh.indexType,
+          static_cast<GLintptr>(mesh.geometry.indexOffset),
+          static_cast<GLint>(mesh.geometry.firstVertex)
+        );
+        commands.endConditionalRender();
+      }
+    }
+  });
+}
+
+// Fits the shadow cascades to the packet's view and fills in the frame
+// block's shadow data. Call after buildLightClusters.
+void buildShadowCascades(
+  FramePacket& packet,
+  const Camera& camera,
+  ShadowCascades& shadowCascades,
+  const std::vector<SceneObject>& sceneObjects
+) {
+  const float aspectRatio{packet.projection[1][1] / packet.projection[0][0]};
+  shadowCascades.update(camera, aspectRatio, moonDirection());
+  for (const SceneObject& object : sceneObjects) {
+    if (!object.movable) {
+      continue;
+    }
+    for (int cascade{ShadowCascades::firstCachedCascade}; cascade < ShadowCascades::cascadeCount; ++cascade) {
+      if (shadowCascades.overlaps(cascade, packet.relativeBounds[object.occlusionObject])) {
+        shadowCascades.markMovableCaster(cascade);
+      }
+    }
+  }
+  // Nothing is rendered into an empty framebuffer, shadows included.
+  if (packet.width <= 0 || packet.height <= 0) {
+    shadowCascades.invalidate();
+  }
+  const glm::mat4 inverseRotation{glm::transpose(camera.rotation())};
+  for (int cascade{}; cascade < ShadowCascades::cascadeCount; ++cascade) {
+    const ShadowCascade& fitted{shadowCascades.cascade(cascade)};
+    packet.shadowCascades[cascade] = fitted;
+    packet.frameBlock.shadowSplits[cascade] = fitted.splitDepth;
+    packet.frameBlock.shadowMatrices[cascade] =
+      ShadowCascades::atlasTransform(cascade) * fitted.lightProjection * inverseRotation;
+  }
+}
+
+// Records the casters of every cascade drawn this frame, with their object
+// blocks after the scene's. Call after recordCommands.
+void recordShadowCommands(
+  FramePacket& packet,
+  const Camera& camera,
+  const ShadowCascades& shadowCascades,
+  const std::vector<SceneObject>& sceneObjects,
+  const GeometryBuffer& geometry,
+  const ProgramData& programData,
+  GLint uniformAlignment
+) {
+  const GLintptr objectStride{alignUniformOffset(sizeof(ObjectBlock), uniformAlignment)};
+  for (int cascade{}; cascade < ShadowCascades::cascadeCount; ++cascade) {
+    CommandBuffer& commands{packet.shadowCommands[cascade]};
+    commands.clear();
+    if (!packet.shadowCascades[cascade].render) {
+      continue;
+    }
+    const glm::mat4& lightProjection{packet.shadowCascades[cascade].lightProjection};
+    for (const SceneObject& object : sceneObjects) {
+      if (!shadowCascades.overlaps(cascade, packet.relativeBounds[object.occlusionObject])) {
+        continue;
+      }
+      const GpuMesh& mesh{programData.meshes[object.mesh]};
+      const GLintptr objectOffset{alignUniformOffset(static_cast<GLintptr>(packet.uniformData.size()), uniformAlignment)};
+      packet.uniformData.resize(static_cast<std::size_t>(objectOffset + objectStride));
+      const ObjectBlock objectBlock{
+        glm::translate(lightProjection, camera.relativePosition(object.position)),
+        glm::vec4{mesh.positionScale, 0.f},
+        glm::vec4{mesh.positionOffset, 0.f},
+        glm::vec4{0.f}
+      };
+      std::memcpy(packet.uniformData.data() + objectOffset, &objectBlock, sizeof(ObjectBlock));
+      commands.bindProgram(programData.shadowProgram);
+      commands.bindVertexArray(geometry.vertexArray(mesh.geometry.pool));
+      commands.bindUniforms(objectBlockBinding, objectOffset, sizeof(ObjectBlock));
+      commands.drawIndexed(
+        GL_TRIANGLES,
+        mesh.indexCount,
+        mesh.indexType,
+        static_cast<GLintptr>(mesh.geometry.indexOffset),
+        static_cast<GLint>(mesh.geometry.firstVertex)
+      );
+    }
+  }
+}
+
+// Exhaust from the camera's two engines and snow falling around it.
+void buildParticles(
+  FramePacket& packet,
+  const Camera& camera,
+  ParticleSpawner& particleSpawner,
+  std::vector<ParticleEmitter>& emitters,
+  double deltaTime
+) {
+  const glm::vec3 forward{camera.forward()};
+  const glm::vec3 right{camera.right()};
+  const glm::vec3 up{glm::cross(right, forward)};
+  emitters.clear();
+  for (const float side : {-1.f, 1.f}) {
+    emitters.push_back(ParticleEmitter{
+      -forward * 3.f - up * 1.5f + right * (1.2f * side),
+      glm::vec3{.1f},
+      -forward * 20.f,
+      2.f,
+      glm::vec4{1.f, .5f, .2f, .5f},
+      .4f,
+      3.f,
+      .5f,
+      10000.f
+    });
+  }
+  emitters.push_back(ParticleEmitter{
+    glm::vec3{0.f, 60.f, 0.f},
+    glm::vec3{150.f, 20.f, 150.f},
+    glm::vec3{0.f, -5.f, 0.f},
+    1.f,
+    glm::vec4{.8f, .85f, .9f, .6f},
+    .15f,
+    14.f,
+    4.f,
+    60000.f
+  });
+  particleSpawner.build(emitters, camera.position, deltaTime, packet.particleBlock);
+}
+
+// Runs until the window closes or frameLimit frames have run, if non-zero.
+// Returns false if a frame failed the steady-state allocation test.
+//
+// The main thread polls events, simulates and culls frame N+1 while a
+// render thread, which owns the GL context for the duration, submits frame
+// N. They meet only in the frame exchange. GLFW callbacks only queue input
+// events; the simulation applies them at the start of its tick.
+bool mainLoop(
+  GLFWwindow* window,
+  JobSystem& jobs,
+  GLResources& resources,
+  const GeometryBuffer& geometry,
+  const TexturePool& textures,
+  const ProgramData& programData,
+  std::uint64_t frameLimit
+) {
+  InputQueue inputQueue{};
+  installInputCallbacks(window, inputQueue);
+  InputState input{window};
+  OcclusionCuller occlusionCuller{jobs};
+  GpuOcclusionCuller gpuOcclusionCuller{resources.get(programData.proxyProgram)};
+  LightClusterer lightClusterer{jobs};
+  const std::vector<SceneLight> sceneLights{createSceneLights()};
+  std::vector<PointLight> viewLights{};
+  Camera camera{};
+  const std::vector<SceneObject> sceneObjects{
+    SceneObject{glm::dvec3{0., 0., -3.}, triangleMesh, checkerMaterial, gpuOcclusionCuller.addObject(), false},
+    SceneObject{glm::dvec3{0., -30., 0.}, terrainMesh, terrainMaterial, gpuOcclusionCuller.addObject(), false},
+  };
+  constexpr GLsizeiptr uniformRegionSize{4 * 1024 * 1024};
+  StreamBuffer uniformStream{resources, GL_UNIFORM_BUFFER, uniformRegionSize};
+  GLint uniformAlignment{};
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  constexpr GLsizeiptr lightRegionSize{4 * 1024 * 1024};
+  StreamBuffer lightStream{resources, GL_TEXTURE_BUFFER, lightRegionSize};
+  LightBuffers lightBuffers{
+    lightStream,
+    createBufferTexture(resources, GL_RGBA32F, lightStream.buffer()),
+    createBufferTexture(resources, GL_RG32UI, lightStream.buffer()),
+    createBufferTexture(resources, GL_R32UI, lightStream.buffer())
+  };
+  // Screenshots are encoded on the readback's own thread.
+  FramebufferReadback readback{resources, [screenshot = 0](const ReadbackImage& image) mutable {
+    const std::string path{"screenshot-" + std::to_string(screenshot++) + ".ppm"};
+    if (!writePortablePixmap(image, path)) {
+      DEBUG_ERROR_LINE("Screenshot: writing " << path << " failed");
+      return;
+    }
+    DEBUG_LOG_LINE("Screenshot: " << path);
+  }};
+  RenderGraph renderGraph{resources};
+  ParticleSpawner particleSpawner{};
+  std::vector<ParticleEmitter> particleEmitters{};
+  ParticleSystem particleSystem{
+    resources,
+    resources.get(programData.particleUpdateProgram),
+    resources.get(programData.particleProgram)
+  };
+  ShadowCascades shadowCascades{};
+  ShadowAtlas shadowAtlas{resources};
+  GpuTimer gpuTimer{gpuTimerScopeCount};
+  std::atomic<float> gpuFrameMilliseconds{-1.f};
+  DynamicResolution dynamicResolution{dynamicResolutionSettings};
+  const VertexArrayHandle emptyVertexArray{resources.createVertexArray()};
+  RenderContext renderContext{
+    resources,
+    gpuOcclusionCuller,
+    uniformStream,
+    uniformAlignment,
+    lightBuffers,
+    readback,
+    renderGraph,
+    gpuTimer,
+    gpuFrameMilliseconds,
+    resources.get(programData.upscaleProgram),
+    glGetUniformLocation(resources.get(programData.upscaleProgram), "region"),
+    resources.get(emptyVertexArray),
+    shadowAtlas,
+    particleSystem,
+    resources.get(programData.depthProgram),
+    resources.get(programData.overdrawProgram),
+    resources.get(programData.heatMapProgram)
+  };
+  FrameExchange<FramePacket> frameExchange{};
+  glfwMakeContextCurrent(nullptr);
+  std::thread renderThread{[window, &renderContext, &frameExchange]() {
+    glfwMakeContextCurrent(window);
+    const AllocationScope renderScope{"render"};
+    for (const FramePacket* packet{frameExchange.beginRead()}; packet; packet = frameExchange.beginRead()) {
+      renderFrame(window, renderContext, *packet);
+      frameExchange.endRead();
+    }
+    glfwMakeContextCurrent(nullptr);
+  }};
+  RenderOptions renderOptions{};
+  double lastTime{glfwGetTime()};
+  bool steadyState{true};
+  for (std::uint64_t frame{}; !glfwWindowShouldClose(window) && (frameLimit == 0 || frame < frameLimit); ++frame) {
+    beginAllocationFrame();
+    const AllocationScope frameScope{"frame"};
+    // Everything allocated from the frame resource dies at the next reset.
+    // Only the main thread uses frame arenas; render data lives in packets.
+    resetFrameArenas();
+    input.update(inputQueue);
+    handleWindowKeys(window, input);
+    handleRenderKeys(input, renderOptions);
+    const double time{glfwGetTime()};
+    const double deltaTime{time - lastTime};
+    updateCamera(input, camera, deltaTime);
+    lastTime = time;
+    // Blocks while the render thread is two frames behind.
+    FramePacket& packet{frameExchange.beginWrite()};
+    packet.width = input.framebufferSize().x;
+    packet.height = input.framebufferSize().y;
+    const float gpuMilliseconds{gpuFrameMilliseconds.exchange(-1.f)};
+    if (gpuMilliseconds >= 0.f) {
+      dynamicResolution.update(gpuMilliseconds);
+    }
+    packet.sceneWidth = std::max(1, static_cast<int>(std::lround(packet.width * dynamicResolution.scale())));
+    packet.sceneHeight = std::max(1, static_cast<int>(std::lround(packet.height * dynamicResolution.scale())));
+    buildFramePacket(packet, camera, occlusionCuller, sceneObjects, geometry, programData);
+    buildLightClusters(packet, camera, lightClusterer, sceneLights, time, viewLights);
+    buildShadowCascades(packet, camera, shadowCascades, sceneObjects);
+    buildParticles(packet, camera, particleSpawner, particleEmitters, deltaTime);
+    recordCommands(jobs, packet, geometry, textures, programData, uniformAlignment);
+    recordShadowCommands(packet, camera, shadowCascades, sceneObjects, geometry, programData, uniformAlignment);
+    packet.options = renderOptions;
+    packet.capture = input.keyPressed(GLFW_KEY_F12);
+    packet.logGpuTimings = input.keyPressed(GLFW_KEY_F5);
+    frameExchange.endWrite();
     glfwPollEvents();
+    steadyState = endAllocationFrame() && steadyState;
   }
+  frameExchange.close();
+  renderThread.join();
+  // The culler, stream buffers, readback, render graph, particle system,
+  // shadow atlas and GPU timer release GL objects on destruction.
+  glfwMakeContextCurrent(window);
+  resources.destroy(emptyVertexArray);
+  resources.destroy(lightBuffers.lights);
+  resources.destroy(lightBuffers.clusters);
+  resources.destroy(lightBuffers.indices);
+  return steadyState;
 }
 
-void cleanUp(GLFWwindow* window, ProgramData& programData) {
+void cleanUp(
+  GLFWwindow* window,
+  GLResources& resources,
+  GeometryBuffer& geometry,
+  TexturePool& textures,
+  ProgramData& programData
+) {
+#ifdef DEBUG
+  const FrameArenaReport arenaReport{frameArenaReport()};
+  DEBUG_LOG_LINE(
+    "Frame arenas: " << arenaReport.arenaCount
+    << ", high-water mark " << arenaReport.highWaterMark << " bytes"
+    << " of " << arenaReport.capacity << " bytes"
+    << ", " << arenaReport.overflowFrames << " overflowing frames"
+  );
+  const GpuMemoryBudget& memory{resources.memory()};
+  for (std::size_t i{}; i < static_cast<std::size_t>(MemoryCategory::Count); ++i) {
+    const MemoryCategory category{static_cast<MemoryCategory>(i)};
+    DEBUG_LOG_LINE(
+      "GPU memory, " << memoryCategoryName(category) << ": peak " << memory.peak(category) << " bytes"
+    );
+  }
+  DEBUG_LOG_LINE(
+    "GPU memory: peak " << memory.peakTotal() << " bytes of " << memory.budgetSize() << " budgeted"
+    << ", " << memory.evictedBytes() << " bytes evicted"
+  );
+  logAllocationReport();
+#endif
+  resources.destroy(programData.program);
+  resources.destroy(programData.proxyProgram);
+  resources.destroy(programData.upscaleProgram);
+  resources.destroy(programData.shadowProgram);
+  resources.destroy(programData.particleUpdateProgram);
+  resources.destroy(programData.particleProgram);
+  resources.destroy(programData.depthProgram);
+  resources.destroy(programData.overdrawProgram);
+  resources.destroy(programData.heatMapProgram);
+  for (const GpuMesh& mesh : programData.meshes) {
+    destroyMesh(geometry, mesh);
+  }
+  geometry.destroy();
+  for (const Material& material : programData.materials) {
+    if (material.textured) {
+      textures.free(material.albedo);
+    }
+  }
+  textures.destroy();
+  // GL objects must go before the context does.
+  resources.destroyAll();
   glfwDestroyWindow(window);
-  glDeleteVertexArrays(1, &programData.vao);
   glfwTerminate();
 }
 
-int main(int /*argc*/, char** /*argv*/) {
+int main(int argc, char** argv) {
+  const bool allocationTest{argc > 1 && std::strcmp(argv[1], "--allocation-test") == 0};
+  if (allocationTest && !allocationTrackingEnabled()) {
+    std::cerr << "--allocation-test needs a build with TRACK_ALLOCATIONS defined\n";
+    std::exit(EXIT_FAILURE);
+  }
   GLFWwindow* window{initializeWindow()};
   if (window == nullptr) {
     std::exit(EXIT_FAILURE);
   }
-  ProgramData programData{initializeGL()};
-  mainLoop(window, programData);
-  cleanUp(window, programData);
+  JobSystem jobs{};
+  GLResources resources{};
+  resources.memory().setBudget(gpuMemoryBudget);
+  GeometryBuffer geometry{resources};
+  TexturePool textures{resources};
+  ProgramData programData{initializeGL(jobs, resources, geometry, textures)};
+  if (allocationTest) {
+    enableSteadyStateTest(allocationTestWarmupFrames);
+  }
+  const std::uint64_t frameLimit{allocationTest ? allocationTestWarmupFrames + allocationTestFrames : 0};
+  const bool steadyState{mainLoop(window, jobs, resources, geometry, textures, programData, frameLimit)};
+  cleanUp(window, resources, geometry, textures, programData);
+  return steadyState ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,207 @@
+#include "mesh.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "debug.hxx"
+#include "mesh_optimizer.hxx"
+
+namespace {
+
+template <typename T>
+void writeVertexData(std::byte* vertex, const AttributeLayout& layout, const T& value) {
+  std::memcpy(vertex + layout.offset, &value, sizeof(value));
+}
+
+#ifdef DEBUG
+std::uint32_t uncompressedStride(const MeshData& mesh) {
+  std::uint32_t stride{sizeof(glm::vec3)};
+  stride += mesh.normals.empty() ? 0 : sizeof(glm::vec3);
+  stride += mesh.tangents.empty() ? 0 : sizeof(glm::vec4);
+  stride += mesh.texCoords.empty() ? 0 : sizeof(glm::vec2);
+  stride += mesh.colors.empty() ? 0 : sizeof(glm::vec4);
+  return stride;
+}
+#endif
+
+} // namespace
+
+ImportedMesh importMesh(MeshData mesh, const ImportOptions& options) {
+  if (options.optimize) {
+    optimizeMesh(mesh);
+  }
+  ImportedMesh imported{};
+  imported.vertexCount = static_cast<std::uint32_t>(mesh.positions.size());
+  imported.indices = mesh.indices;
+  glm::vec3 low{std::numeric_limits<float>::max()};
+  glm::vec3 high{std::numeric_limits<float>::lowest()};
+  for (const glm::vec3& position : mesh.positions) {
+    low = glm::min(low, position);
+    high = glm::max(high, position);
+  }
+  imported.bounds = BoundingBox{low, high};
+  // Flat axes still need a non-zero scale to stay invertible.
+  const glm::vec3 extent{glm::max(high - low, glm::vec3{std::numeric_limits<float>::min()})};
+  const float quantizationError{std::max({extent.x, extent.y, extent.z}) / 65535.f * .5f};
+  const bool quantizePositions{quantizationError <= options.maxPositionError};
+  bool halfTexCoords{true};
+  for (const glm::vec2& texCoord : mesh.texCoords) {
+    halfTexCoords = halfTexCoords
+      && std::abs(texCoord.x) <= options.maxHalfTexCoord
+      && std::abs(texCoord.y) <= options.maxHalfTexCoord;
+  }
+
+  std::vector<std::pair<VertexAttribute, AttributeEncoding>> attributes{
+    {VertexAttribute::Position, quantizePositions ? AttributeEncoding::Unorm16x4 : AttributeEncoding::Float32x4},
+  };
+  if (!mesh.normals.empty()) {
+    attributes.emplace_back(VertexAttribute::Normal, AttributeEncoding::Snorm16x2Octahedral);
+  }
+  if (!mesh.tangents.empty()) {
+    attributes.emplace_back(VertexAttribute::Tangent, AttributeEncoding::Snorm16x2Octahedral);
+  }
+  if (!mesh.texCoords.empty()) {
+    attributes.emplace_back(
+      VertexAttribute::TexCoord,
+      halfTexCoords ? AttributeEncoding::Float16x2 : AttributeEncoding::Float32x2
+    );
+  }
+  if (!mesh.colors.empty()) {
+    attributes.emplace_back(VertexAttribute::Color, AttributeEncoding::Unorm10x3_2);
+  }
+  imported.format = makeVertexFormat(attributes);
+  const VertexFormat& format{imported.format};
+  imported.positionScale = quantizePositions ? extent : glm::vec3{1.f};
+  imported.positionOffset = quantizePositions ? low : glm::vec3{0.f};
+
+  imported.vertices.resize(static_cast<std::size_t>(format.stride) * imported.vertexCount);
+  for (std::uint32_t i{}; i < imported.vertexCount; ++i) {
+    std::byte* vertex{imported.vertices.data() + static_cast<std::size_t>(format.stride) * i};
+    // The position's fourth component carries the bitangent sign as 0 or 1.
+    const float handedness{mesh.tangents.empty() || mesh.tangents[i].w >= 0.f ? 1.f : 0.f};
+    for (const AttributeLayout& layout : format.attributes) {
+      switch (layout.attribute) {
+        case VertexAttribute::Position:
+          if (quantizePositions) {
+            const glm::vec3 normalized{(mesh.positions[i] - low) / extent};
+            const std::uint16_t encoded[4]{
+              static_cast<std::uint16_t>(std::lround(std::clamp(normalized.x, 0.f, 1.f) * 65535.f)),
+              static_cast<std::uint16_t>(std::lround(std::clamp(normalized.y, 0.f, 1.f) * 65535.f)),
+              static_cast<std::uint16_t>(std::lround(std::clamp(normalized.z, 0.f, 1.f) * 65535.f)),
+              static_cast<std::uint16_t>(handedness * 65535.f),
+            };
+            writeVertexData(vertex, layout, encoded);
+          } else {
+            writeVertexData(vertex, layout, glm::vec4{mesh.positions[i], handedness});
+          }
+          break;
+        case VertexAttribute::Normal:
+          writeVertexData(vertex, layout, encodeOctahedral(glm::normalize(mesh.normals[i])));
+          break;
+        case VertexAttribute::Tangent:
+          writeVertexData(vertex, layout, encodeOctahedral(glm::normalize(glm::vec3{mesh.tangents[i]})));
+          break;
+        case VertexAttribute::TexCoord:
+          if (layout.encoding == AttributeEncoding::Float16x2) {
+            const std::uint16_t encoded[2]{encodeHalf(mesh.texCoords[i].x), encodeHalf(mesh.texCoords[i].y)};
+            writeVertexData(vertex, layout, encoded);
+          } else {
+            writeVertexData(vertex, layout, mesh.texCoords[i]);
+          }
+          break;
+        case VertexAttribute::Color:
+          writeVertexData(vertex, layout, encodeUnorm10x3_2(mesh.colors[i]));
+          break;
+      }
+    }
+  }
+  DEBUG_LOG_LINE(
+    "Mesh import: " << imported.vertexCount << " vertices, "
+    << format.stride << " bytes per vertex instead of " << uncompressedStride(mesh)
+    << (quantizePositions ? ", quantized positions" : ", float positions")
+  );
+  return imported;
+}
+
+GpuMesh uploadMesh(GeometryBuffer& geometry, const ImportedMesh& mesh) {
+  GpuMesh gpuMesh{};
+  gpuMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+  gpuMesh.positionScale = mesh.positionScale;
+  gpuMesh.positionOffset = mesh.positionOffset;
+  gpuMesh.bounds = mesh.bounds;
+  // Indices stay relative to the mesh; the base vertex offsets them.
+  if (mesh.vertexCount <= std::numeric_limits<std::uint16_t>::max() + 1u) {
+    const std::vector<std::uint16_t> indices{mesh.indices.begin(), mesh.indices.end()};
+    gpuMesh.indexType = GL_UNSIGNED_SHORT;
+    gpuMesh.geometry = geometry.allocate(
+      mesh.format,
+      mesh.vertices.data(),
+      mesh.vertexCount,
+      indices.data(),
+      static_cast<std::uint32_t>(indices.size() * sizeof(std::uint16_t))
+    );
+  } else {
+    gpuMesh.indexType = GL_UNSIGNED_INT;
+    gpuMesh.geometry = geometry.allocate(
+      mesh.format,
+      mesh.vertices.data(),
+      mesh.vertexCount,
+      mesh.indices.data(),
+      static_cast<std::uint32_t>(mesh.indices.size() * sizeof(std::uint32_t))
+    );
+  }
+  return gpuMesh;
+}
+
+void destroyMesh(GeometryBuffer& geometry, const GpuMesh& mesh) {
+  geometry.free(mesh.geometry);
+}
+
+MeshData generateTerrain(JobSystem& jobs, int resolution, float size, float height) {
+  MeshData terrain{};
+  const float step{size / static_cast<float>(resolution - 1)};
+  const auto heightAt{[size, height](float x, float z) {
+    const float u{x / size * 6.2831853f};
+    const float v{z / size * 6.2831853f};
+    return height * (.5f * std::sin(u * 2.f) * std::cos(v * 3.f) + .25f * std::sin(u * 7.f + v * 5.f));
+  }};
+  const std::size_t vertexCount{static_cast<std::size_t>(resolution) * static_cast<std::size_t>(resolution)};
+  terrain.positions.resize(vertexCount);
+  terrain.normals.resize(vertexCount);
+  terrain.tangents.resize(vertexCount);
+  terrain.texCoords.resize(vertexCount);
+  terrain.colors.resize(vertexCount);
+  // Rows are independent, so they are generated in parallel.
+  constexpr std::uint32_t rowsPerJob{8};
+  jobs.parallelFor(static_cast<std::uint32_t>(resolution), rowsPerJob, [&](std::uint32_t begin, std::uint32_t end) {
+    for (int row{static_cast<int>(begin)}; row < static_cast<int>(end); ++row) {
+      for (int column{}; column < resolution; ++column) {
+        const std::size_t vertex{static_cast<std::size_t>(row * resolution + column)};
+        const float x{static_cast<float>(column) * step - size * .5f};
+        const float z{static_cast<float>(row) * step - size * .5f};
+        const float y{heightAt(x, z)};
+        terrain.positions[vertex] = glm::vec3{x, y, z};
+        const float slopeX{heightAt(x + step, z) - heightAt(x - step, z)};
+        const float slopeZ{heightAt(x, z + step) - heightAt(x, z - step)};
+        terrain.normals[vertex] = glm::normalize(glm::vec3{-slopeX, 2.f * step, -slopeZ});
+        terrain.tangents[vertex] = glm::vec4{glm::normalize(glm::vec3{2.f * step, slopeX, 0.f}), 1.f};
+        terrain.texCoords[vertex] = glm::vec2{
+          static_cast<float>(column) / static_cast<float>(resolution - 1),
+          static_cast<float>(row) / static_cast<float>(resolution - 1)
+        };
+        const float altitude{glm::clamp(y / height * .5f + .5f, 0.f, 1.f)};
+        terrain.colors[vertex] = glm::mix(glm::vec4{.2f, .45f, .15f, 1.f}, glm::vec4{.55f, .45f, .35f, 1.f}, altitude);
+      }
+    }
+  });
+  for (int row{}; row + 1 < resolution; ++row) {
+    for (int column{}; column + 1 < resolution; ++column) {
+      const std::uint32_t corner{static_cast<std::uint32_t>(row * resolution + column)};
+      const std::uint32_t below{corner + static_cast<std::uint32_t>(resolution)};
+      terrain.indices.insert(terrain.indices.end(), {corner, below, corner + 1, corner + 1, below, below + 1});
+    }
+  }
+  return terrain;
+}
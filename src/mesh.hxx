@@ -0,0 +1,69 @@
+#ifndef MESH_HXX
+#define MESH_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "bounds.hxx"
+#include "geometry_buffer.hxx"
+#include "job_system.hxx"
+#include "vertex_format.hxx"
+
+// Full-precision source data. Every attribute but positions is optional and
+// must otherwise have one entry per position.
+struct MeshData {
+  std::vector<glm::vec3> positions{};
+  std::vector<glm::vec3> normals{};
+  // w holds the bitangent sign.
+  std::vector<glm::vec4> tangents{};
+  std::vector<glm::vec2> texCoords{};
+  std::vector<glm::vec4> colors{};
+  std::vector<std::uint32_t> indices{};
+};
+
+struct ImportOptions {
+  // Positions are quantized to 16 bits per axis unless that would move a
+  // vertex further than this, in mesh units.
+  float maxPositionError{.01f};
+  // Texture coordinates use half floats while every component stays within
+  // this magnitude, which keeps the error under 1/1024.
+  float maxHalfTexCoord{2.f};
+  // Reorders triangles and vertices for the post-transform cache, overdraw
+  // and fetch locality. The rendered result is unchanged.
+  bool optimize{true};
+};
+
+struct ImportedMesh {
+  VertexFormat format;
+  std::vector<std::byte> vertices;
+  std::vector<std::uint32_t> indices;
+  std::uint32_t vertexCount;
+  // Dequantization: position = encoded * positionScale + positionOffset.
+  glm::vec3 positionScale;
+  glm::vec3 positionOffset;
+  BoundingBox bounds;
+};
+
+// Chooses the most compact encoding for each attribute present in the mesh
+// and interleaves the encoded vertices.
+ImportedMesh importMesh(MeshData mesh, const ImportOptions& options = {});
+
+struct GpuMesh {
+  GeometryRange geometry;
+  GLsizei indexCount;
+  GLenum indexType;
+  glm::vec3 positionScale;
+  glm::vec3 positionOffset;
+  BoundingBox bounds;
+};
+
+GpuMesh uploadMesh(GeometryBuffer& geometry, const ImportedMesh& mesh);
+void destroyMesh(GeometryBuffer& geometry, const GpuMesh& mesh);
+
+MeshData generateTerrain(JobSystem& jobs, int resolution, float size, float height);
+
+#endif // MESH_HXX
@@ -0,0 +1,285 @@
+#include "mesh_optimizer.hxx"
+
+#include <algorithm>
+#include <numeric>
+
+#include "debug.hxx"
+#include "mesh.hxx"
+
+namespace {
+
+constexpr std::uint32_t defaultCacheSize{16};
+constexpr float defaultOverdrawThreshold{1.05f};
+
+// FIFO cache simulator shared by the analysis and the soft cluster split.
+class VertexCache {
+public:
+  VertexCache(std::uint32_t vertexCount, std::uint32_t cacheSize) :
+    timestamps(vertexCount, 0), cacheSize{cacheSize} {}
+
+  // Returns true on a miss.
+  bool access(std::uint32_t vertex) {
+    if (timestamps[vertex] != 0 && time - timestamps[vertex] < cacheSize) {
+      return false;
+    }
+    timestamps[vertex] = time++;
+    return true;
+  }
+
+  void flush() {
+    time += cacheSize;
+  }
+
+private:
+  std::vector<std::uint32_t> timestamps;
+  std::uint32_t cacheSize;
+  std::uint32_t time{1};
+};
+
+template <typename Container>
+void reorder(Container& values, const std::vector<std::uint32_t>& newToOld) {
+  if (values.empty()) {
+    return;
+  }
+  Container reordered{};
+  reordered.reserve(newToOld.size());
+  for (const std::uint32_t oldIndex : newToOld) {
+    reordered.push_back(values[oldIndex]);
+  }
+  values.swap(reordered);
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize) {
+  VertexCache cache{vertexCount, cacheSize};
+  std::vector<bool> referenced(vertexCount, false);
+  std::uint32_t misses{};
+  std::uint32_t uniqueVertices{};
+  for (const std::uint32_t index : indices) {
+    misses += cache.access(index);
+    if (!referenced[index]) {
+      referenced[index] = true;
+      ++uniqueVertices;
+    }
+  }
+  const std::size_t triangleCount{indices.size() / 3};
+  return VertexCacheStats{
+    triangleCount ? static_cast<float>(misses) / static_cast<float>(triangleCount) : 0.f,
+    uniqueVertices ? static_cast<float>(misses) / static_cast<float>(uniqueVertices) : 0.f
+  };
+}
+
+std::vector<std::uint32_t> optimizeVertexCache(std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize) {
+  const std::uint32_t triangleCount{static_cast<std::uint32_t>(indices.size() / 3)};
+  // Vertex-to-triangle adjacency in compressed rows.
+  std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+  for (const std::uint32_t index : indices) {
+    ++liveTriangles[index];
+  }
+  std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+  std::vector<std::uint32_t> adjacency(indices.size());
+  std::vector<std::uint32_t> fill{adjacencyOffsets.begin(), adjacencyOffsets.end() - 1};
+  for (std::uint32_t triangle{}; triangle < triangleCount; ++triangle) {
+    for (int corner{}; corner < 3; ++corner) {
+      adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+    }
+  }
+
+  std::vector<std::uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<std::uint32_t> deadEnds{};
+  std::vector<std::uint32_t> candidates{};
+  std::vector<std::uint32_t> output{};
+  std::vector<std::uint32_t> hardBoundaries{0};
+  output.reserve(indices.size());
+  std::uint32_t time{cacheSize + 1};
+  std::uint32_t cursor{};
+  const auto skipDeadEnd{[&]() -> std::int64_t {
+    while (!deadEnds.empty()) {
+      const std::uint32_t vertex{deadEnds.back()};
+      deadEnds.pop_back();
+      if (liveTriangles[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for (; cursor < vertexCount; ++cursor) {
+      if (liveTriangles[cursor] > 0) {
+        return cursor;
+      }
+    }
+    return -1;
+  }};
+
+  std::int64_t fanning{triangleCount ? static_cast<std::int64_t>(indices[0]) : -1};
+  while (fanning >= 0) {
+    candidates.clear();
+    const std::uint32_t vertex{static_cast<std::uint32_t>(fanning)};
+    for (std::uint32_t a{adjacencyOffsets[vertex]}; a < adjacencyOffsets[vertex + 1]; ++a) {
+      const std::uint32_t triangle{adjacency[a]};
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (int corner{}; corner < 3; ++corner) {
+        const std::uint32_t v{indices[triangle * 3 + corner]};
+        output.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        --liveTriangles[v];
+        if (time - cacheTime[v] > cacheSize) {
+          cacheTime[v] = time++;
+        }
+      }
+    }
+    // Prefer the candidate that will still be in the cache after its
+    // remaining triangles are emitted, and among those the oldest.
+    std::int64_t next{-1};
+    std::int64_t best{-1};
+    for (const std::uint32_t v : candidates) {
+      if (liveTriangles[v] == 0) {
+        continue;
+      }
+      std::int64_t priority{0};
+      if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+        priority = time - cacheTime[v];
+      }
+      if (priority > best) {
+        best = priority;
+        next = v;
+      }
+    }
+    if (next < 0) {
+      next = skipDeadEnd();
+      if (next >= 0 && output.size() < indices.size()) {
+        hardBoundaries.push_back(static_cast<std::uint32_t>(output.size() / 3));
+      }
+    }
+    fanning = next;
+  }
+  indices.swap(output);
+  return hardBoundaries;
+}
+
+void optimizeOverdraw(
+  std::vector<std::uint32_t>& indices,
+  const std::vector<glm::vec3>& positions,
+  const std::vector<std::uint32_t>& hardBoundaries,
+  std::uint32_t cacheSize,
+  float threshold
+) {
+  const std::uint32_t triangleCount{static_cast<std::uint32_t>(indices.size() / 3)};
+  if (triangleCount == 0) {
+    return;
+  }
+  const float meshACMR{analyzeVertexCache(indices, static_cast<std::uint32_t>(positions.size()), cacheSize).acmr};
+  // Soft boundaries: restart the cache at every hard boundary and cut the
+  // cluster as soon as its running ACMR is good enough.
+  std::vector<std::uint32_t> boundaries{};
+  VertexCache cache{static_cast<std::uint32_t>(positions.size()), cacheSize};
+  std::size_t nextHard{0};
+  std::uint32_t clusterStart{};
+  std::uint32_t clusterMisses{};
+  constexpr std::uint32_t minimumClusterSize{32};
+  for (std::uint32_t triangle{}; triangle < triangleCount; ++triangle) {
+    const bool hard{nextHard < hardBoundaries.size() && hardBoundaries[nextHard] == triangle};
+    const std::uint32_t clusterSize{triangle - clusterStart};
+    const bool soft{
+      clusterSize >= minimumClusterSize
+      && static_cast<float>(clusterMisses) / static_cast<float>(clusterSize) <= threshold * meshACMR
+    };
+    if (hard || soft || triangle == 0) {
+      boundaries.push_back(triangle);
+      clusterStart = triangle;
+      clusterMisses = 0;
+      cache.flush();
+      nextHard += hard;
+    }
+    for (int corner{}; corner < 3; ++corner) {
+      clusterMisses += cache.access(indices[triangle * 3 + corner]);
+    }
+  }
+  boundaries.push_back(triangleCount);
+
+  glm::vec3 meshCentroid{0.f};
+  float meshArea{};
+  struct Cluster {
+    std::uint32_t begin;
+    std::uint32_t end;
+    glm::vec3 centroid;
+    glm::vec3 normal;
+    float sortKey;
+  };
+  std::vector<Cluster> clusters{};
+  for (std::size_t c{}; c + 1 < boundaries.size(); ++c) {
+    Cluster cluster{boundaries[c], boundaries[c + 1], glm::vec3{0.f}, glm::vec3{0.f}, 0.f};
+    float area{};
+    for (std::uint32_t triangle{cluster.begin}; triangle < cluster.end; ++triangle) {
+      const glm::vec3& a{positions[indices[triangle * 3]]};
+      const glm::vec3& b{positions[indices[triangle * 3 + 1]]};
+      const glm::vec3& c2{positions[indices[triangle * 3 + 2]]};
+      const glm::vec3 normal{glm::cross(b - a, c2 - a)};
+      const float triangleArea{glm::length(normal) * .5f};
+      cluster.centroid += (a + b + c2) * (triangleArea / 3.f);
+      cluster.normal += normal;
+      area += triangleArea;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += area;
+    cluster.centroid = area > 0.f ? cluster.centroid / area : positions[indices[cluster.begin * 3]];
+    clusters.push_back(cluster);
+  }
+  meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3{0.f};
+  for (Cluster& cluster : clusters) {
+    const float normalLength{glm::length(cluster.normal)};
+    cluster.sortKey = normalLength > 0.f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.f;
+  }
+  std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+    return a.sortKey > b.sortKey;
+  });
+  std::vector<std::uint32_t> output{};
+  output.reserve(indices.size());
+  for (const Cluster& cluster : clusters) {
+    output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+  }
+  indices.swap(output);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+  constexpr std::uint32_t unassigned{~0u};
+  std::vector<std::uint32_t> oldToNew(mesh.positions.size(), unassigned);
+  std::vector<std::uint32_t> newToOld{};
+  newToOld.reserve(mesh.positions.size());
+  for (std::uint32_t& index : mesh.indices) {
+    if (oldToNew[index] == unassigned) {
+      oldToNew[index] = static_cast<std::uint32_t>(newToOld.size());
+      newToOld.push_back(index);
+    }
+    index = oldToNew[index];
+  }
+  reorder(mesh.positions, newToOld);
+  reorder(mesh.normals, newToOld);
+  reorder(mesh.tangents, newToOld);
+  reorder(mesh.texCoords, newToOld);
+  reorder(mesh.colors, newToOld);
+}
+
+void optimizeMesh(MeshData& mesh) {
+  const std::uint32_t vertexCount{static_cast<std::uint32_t>(mesh.positions.size())};
+  const VertexCacheStats before{analyzeVertexCache(mesh.indices, vertexCount, defaultCacheSize)};
+  const std::vector<std::uint32_t> hardBoundaries{optimizeVertexCache(mesh.indices, vertexCount, defaultCacheSize)};
+  optimizeOverdraw(mesh.indices, mesh.positions, hardBoundaries, defaultCacheSize, defaultOverdrawThreshold);
+  optimizeVertexFetch(mesh);
+  const VertexCacheStats after{
+    analyzeVertexCache(mesh.indices, static_cast<std::uint32_t>(mesh.positions.size()), defaultCacheSize)
+  };
+  DEBUG_LOG_LINE(
+    "Mesh optimizer: ACMR " << before.acmr << " -> " << after.acmr
+    << ", ATVR " << before.atvr << " -> " << after.atvr
+  );
+#ifndef DEBUG
+  static_cast<void>(before);
+  static_cast<void>(after);
+#endif
+}
@@ -0,0 +1,45 @@
+#ifndef MESH_OPTIMIZER_HXX
+#define MESH_OPTIMIZER_HXX
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct MeshData;
+
+// Post-transform vertex cache efficiency under a FIFO cache model.
+struct VertexCacheStats {
+  // Average cache misses per triangle; 0.5 is the ideal for a regular grid.
+  float acmr;
+  // Average transformations per referenced vertex; 1.0 is the ideal.
+  float atvr;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize);
+
+// Tipsify (Sander, Nehab and Barczak 2007). Reorders triangles for vertex
+// cache hits and returns the triangle offsets where the walk hit a dead end,
+// which are the natural cluster boundaries for overdraw ordering.
+std::vector<std::uint32_t> optimizeVertexCache(std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize);
+
+// Splits the cache-optimized triangle order into clusters and sorts them so
+// that outward-facing clusters draw first, reducing overdraw for most views.
+// Soft boundaries are added wherever a cluster's ACMR is still within
+// threshold times the whole mesh's, so cache efficiency barely changes.
+void optimizeOverdraw(
+  std::vector<std::uint32_t>& indices,
+  const std::vector<glm::vec3>& positions,
+  const std::vector<std::uint32_t>& hardBoundaries,
+  std::uint32_t cacheSize,
+  float threshold
+);
+
+// Renumbers vertices in first-use order and drops unreferenced ones, so that
+// vertex fetch walks memory linearly.
+void optimizeVertexFetch(MeshData& mesh);
+
+// Runs all three passes and logs ACMR and ATVR before and after.
+void optimizeMesh(MeshData& mesh);
+
+#endif // MESH_OPTIMIZER_HXX
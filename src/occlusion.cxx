@@ -0,0 +1,240 @@
+#include "occlusion.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float nearClipW{1e-4f};
+// Below this many triangles the cost of handing out jobs outweighs the work.
+constexpr std::size_t parallelTriangleThreshold{64};
+
+struct EdgeFunction {
+  float a;
+  float b;
+  float c;
+
+  EdgeFunction(const glm::vec3& from, const glm::vec3& to) :
+    a{-(to.y - from.y)}, b{to.x - from.x}, c{(to.y - from.y) * from.x - (to.x - from.x) * from.y} {}
+
+  float operator()(float x, float y) const {
+    return a * x + b * y + c;
+  }
+};
+
+glm::vec3 toScreen(const glm::vec4& clip) {
+  const float inverseW{1.f / clip.w};
+  return glm::vec3{
+    (clip.x * inverseW * .5f + .5f) * static_cast<float>(OcclusionCuller::width),
+    (clip.y * inverseW * .5f + .5f) * static_cast<float>(OcclusionCuller::height),
+    clip.z * inverseW * .5f + .5f
+  };
+}
+
+// Clamps before converting so that huge projected coordinates stay defined.
+int floorToPixel(float value, int limit) {
+  return static_cast<int>(std::floor(std::clamp(value, -1.f, static_cast<float>(limit + 1))));
+}
+
+int ceilToPixel(float value, int limit) {
+  return static_cast<int>(std::ceil(std::clamp(value, -1.f, static_cast<float>(limit + 1))));
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(JobSystem& jobs) :
+  jobs{jobs},
+  tileBins(tilesX * tilesY),
+  depthBuffer(width * height, 1.f),
+  tileMaxDepth(tilesX * tilesY, 1.f) {}
+
+void OcclusionCuller::clearOccluders() {
+  occluders.clear();
+}
+
+void OcclusionCuller::addOccluder(OccluderMesh occluder) {
+  occluders.push_back(std::move(occluder));
+}
+
+void OcclusionCuller::render(const glm::mat4& viewProjection) {
+  this->viewProjection = viewProjection;
+  triangles.clear();
+  for (std::vector<std::uint32_t>& bin : tileBins) {
+    bin.clear();
+  }
+  for (const OccluderMesh& occluder : occluders) {
+    const glm::mat4 modelViewProjection{viewProjection * occluder.model};
+    for (std::size_t i{}; i + 2 < occluder.indices.size(); i += 3) {
+      ScreenTriangle triangle{};
+      bool clipped{};
+      for (int v{}; v < 3; ++v) {
+        const glm::vec4 clip{modelViewProjection * glm::vec4{occluder.positions[occluder.indices[i + v]], 1.f}};
+        // Dropping a triangle that crosses the near plane only weakens culling.
+        if (clip.w < nearClipW) {
+          clipped = true;
+          break;
+        }
+        triangle.vertices[v] = toScreen(clip);
+      }
+      if (clipped) {
+        continue;
+      }
+      const glm::vec3 low{glm::min(glm::min(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2])};
+      const glm::vec3 high{glm::max(glm::max(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2])};
+      const int tileX0{std::max(0, floorToPixel(low.x, width) / tileWidth)};
+      const int tileY0{std::max(0, floorToPixel(low.y, height) / tileHeight)};
+      const int tileX1{std::min(tilesX - 1, floorToPixel(high.x, width) / tileWidth)};
+      const int tileY1{std::min(tilesY - 1, floorToPixel(high.y, height) / tileHeight)};
+      if (high.x < 0.f || high.y < 0.f || low.z > 1.f || tileX0 > tileX1 || tileY0 > tileY1) {
+        continue;
+      }
+      const std::uint32_t index{static_cast<std::uint32_t>(triangles.size())};
+      triangles.push_back(triangle);
+      for (int tileY{tileY0}; tileY <= tileY1; ++tileY) {
+        for (int tileX{tileX0}; tileX <= tileX1; ++tileX) {
+          tileBins[tileY * tilesX + tileX].push_back(index);
+        }
+      }
+    }
+  }
+  constexpr std::uint32_t tileCount{tilesX * tilesY};
+  // Tiles own disjoint pixels, so they need no synchronization.
+  const auto rasterizeTiles{[this](std::uint32_t begin, std::uint32_t end) {
+    for (std::uint32_t tile{begin}; tile < end; ++tile) {
+      rasterizeTile(static_cast<int>(tile));
+    }
+  }};
+  if (triangles.size() < parallelTriangleThreshold) {
+    rasterizeTiles(0, tileCount);
+    return;
+  }
+  jobs.parallelFor(tileCount, 1, rasterizeTiles);
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+  const int tileX0{(tile % tilesX) * tileWidth};
+  const int tileY0{(tile / tilesX) * tileHeight};
+  for (int y{tileY0}; y < tileY0 + tileHeight; ++y) {
+    std::fill_n(depthBuffer.begin() + y * width + tileX0, tileWidth, 1.f);
+  }
+  for (const std::uint32_t index : tileBins[tile]) {
+    glm::vec3 v0{triangles[index].vertices[0]};
+    glm::vec3 v1{triangles[index].vertices[1]};
+    glm::vec3 v2{triangles[index].vertices[2]};
+    float area{(v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x)};
+    if (std::abs(area) < 1e-6f) {
+      continue;
+    }
+    // Occluders are treated as two-sided.
+    if (area < 0.f) {
+      std::swap(v1, v2);
+      area = -area;
+    }
+    const EdgeFunction e0{v1, v2};
+    const EdgeFunction e1{v2, v0};
+    const EdgeFunction e2{v0, v1};
+    // Depth is affine in screen space, so it is a plane z = a*x + b*y + c.
+    const float inverseArea{1.f / area};
+    const float za{(v0.z * e0.a + v1.z * e1.a + v2.z * e2.a) * inverseArea};
+    const float zb{(v0.z * e0.b + v1.z * e1.b + v2.z * e2.b) * inverseArea};
+    const float zc{(v0.z * e0.c + v1.z * e1.c + v2.z * e2.c) * inverseArea};
+    const int x0{std::max(tileX0, floorToPixel(std::min({v0.x, v1.x, v2.x}), width) & ~3)};
+    const int y0{std::max(tileY0, floorToPixel(std::min({v0.y, v1.y, v2.y}), height))};
+    const int x1{std::min(tileX0 + tileWidth, ceilToPixel(std::max({v0.x, v1.x, v2.x}), width))};
+    const int y1{std::min(tileY0 + tileHeight, ceilToPixel(std::max({v0.y, v1.y, v2.y}), height))};
+    for (int y{y0}; y < y1; ++y) {
+      const float py{static_cast<float>(y) + .5f};
+      float* row{depthBuffer.data() + y * width};
+#ifdef OCCLUSION_SSE2
+      const __m128 laneOffsets{_mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f)};
+      const __m128 zero{_mm_setzero_ps()};
+      const __m128 row0{_mm_set1_ps(e0.b * py + e0.c)};
+      const __m128 row1{_mm_set1_ps(e1.b * py + e1.c)};
+      const __m128 row2{_mm_set1_ps(e2.b * py + e2.c)};
+      const __m128 rowZ{_mm_set1_ps(zb * py + zc)};
+      for (int x{x0}; x < x1; x += 4) {
+        const __m128 px{_mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets)};
+        const __m128 w0{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.a), px), row0)};
+        const __m128 w1{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.a), px), row1)};
+        const __m128 w2{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.a), px), row2)};
+        const __m128 inside{_mm_and_ps(
+          _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+          _mm_cmpge_ps(w2, zero)
+        )};
+        if (_mm_movemask_ps(inside) == 0) {
+          continue;
+        }
+        const __m128 z{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), rowZ)};
+        const __m128 depth{_mm_loadu_ps(row + x)};
+        const __m128 nearer{_mm_min_ps(depth, z)};
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+      }
+#else
+      for (int x{x0}; x < x1; ++x) {
+        const float px{static_cast<float>(x) + .5f};
+        if (e0(px, py) >= 0.f && e1(px, py) >= 0.f && e2(px, py) >= 0.f) {
+          row[x] = std::min(row[x], za * px + zb * py + zc);
+        }
+      }
+#endif
+    }
+  }
+  float maxDepth{};
+  for (int y{tileY0}; y < tileY0 + tileHeight; ++y) {
+    const float* row{depthBuffer.data() + y * width + tileX0};
+    maxDepth = std::max(maxDepth, *std::max_element(row, row + tileWidth));
+  }
+  tileMaxDepth[tile] = maxDepth;
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox& box) const {
+  glm::vec3 low{static_cast<float>(width), static_cast<float>(height), 1.f};
+  glm::vec3 high{0.f};
+  for (int corner{}; corner < 8; ++corner) {
+    const glm::vec4 position{
+      corner & 1 ? box.max.x : box.min.x,
+      corner & 2 ? box.max.y : box.min.y,
+      corner & 4 ? box.max.z : box.min.z,
+      1.f
+    };
+    const glm::vec4 clip{viewProjection * position};
+    if (clip.w < nearClipW) {
+      return true;
+    }
+    const glm::vec3 screen{toScreen(clip)};
+    low = glm::min(low, screen);
+    high = glm::max(high, screen);
+  }
+  const int x0{std::max(0, floorToPixel(low.x, width))};
+  const int y0{std::max(0, floorToPixel(low.y, height))};
+  const int x1{std::min(width, ceilToPixel(high.x, width))};
+  const int y1{std::min(height, ceilToPixel(high.y, height))};
+  if (x0 >= x1 || y0 >= y1) {
+    // Entirely outside the screen; frustum culling decides these.
+    return true;
+  }
+  const float boxDepth{low.z};
+  for (int tileY{y0 / tileHeight}; tileY <= (y1 - 1) / tileHeight; ++tileY) {
+    for (int tileX{x0 / tileWidth}; tileX <= (x1 - 1) / tileWidth; ++tileX) {
+      if (tileMaxDepth[tileY * tilesX + tileX] < boxDepth) {
+        continue;
+      }
+      const int rectX0{std::max(x0, tileX * tileWidth)};
+      const int rectY0{std::max(y0, tileY * tileHeight)};
+      const int rectX1{std::min(x1, (tileX + 1) * tileWidth)};
+      const int rectY1{std::min(y1, (tileY + 1) * tileHeight)};
+      for (int y{rectY0}; y < rectY1; ++y) {
+        const float* row{depthBuffer.data() + y * width};
+        if (std::any_of(row + rectX0, row + rectX1, [boxDepth](float depth) { return depth >= boxDepth; })) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
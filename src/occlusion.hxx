@@ -0,0 +1,58 @@
+#ifndef OCCLUSION_HXX
+#define OCCLUSION_HXX
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.hxx"
+#include "job_system.hxx"
+
+// Occluders are a handful of cheap, closed, conservative meshes (building
+// shells, terrain chunks) rather than the render meshes themselves.
+struct OccluderMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<std::uint32_t> indices;
+  glm::mat4 model;
+};
+
+// Software occlusion culler. Occluders are rasterized each frame into a
+// low-resolution depth buffer split into tiles; tiles are rasterized in
+// parallel on the job system, four pixels at a time with masked SSE depth writes. Bounding
+// boxes are then tested against per-tile maximum depth first and against
+// individual pixels only when that is inconclusive.
+class OcclusionCuller {
+public:
+  static constexpr int width{256};
+  static constexpr int height{128};
+  static constexpr int tileWidth{32};
+  static constexpr int tileHeight{16};
+  static constexpr int tilesX{width / tileWidth};
+  static constexpr int tilesY{height / tileHeight};
+
+  explicit OcclusionCuller(JobSystem& jobs);
+
+  void clearOccluders();
+  void addOccluder(OccluderMesh occluder);
+  void render(const glm::mat4& viewProjection);
+  // Conservative: returns true unless the box is certainly hidden.
+  bool isVisible(const BoundingBox& box) const;
+
+private:
+  struct ScreenTriangle {
+    glm::vec3 vertices[3];
+  };
+
+  void rasterizeTile(int tile);
+
+  JobSystem& jobs;
+  std::vector<OccluderMesh> occluders{};
+  std::vector<ScreenTriangle> triangles{};
+  std::vector<std::vector<std::uint32_t>> tileBins;
+  std::vector<float> depthBuffer;
+  std::vector<float> tileMaxDepth;
+  glm::mat4 viewProjection{1.f};
+};
+
+#endif // OCCLUSION_HXX
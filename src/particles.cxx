@@ -0,0 +1,157 @@
+#include "particles.hxx"
+
+#include <algorithm>
+
+namespace {
+
+// Matches the captured outputs of particles_update.vert.
+struct Particle {
+  glm::vec4 positionAge;
+  glm::vec4 velocityLifetime;
+  float size;
+  // RGBA8.
+  std::uint32_t color;
+};
+static_assert(sizeof(Particle) == 40, "Particle must match the transform feedback layout");
+
+// Long stalls would otherwise emit a burst and fling particles far.
+constexpr double maxTimeStep{.1};
+
+void setParticleAttributes(GLuint buffer, GLuint divisor) {
+  constexpr GLsizei stride{sizeof(Particle)};
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(Particle, positionAge)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(Particle, velocityLifetime)));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(Particle, size)));
+  glEnableVertexAttribArray(3);
+  glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, stride, reinterpret_cast<const void*>(offsetof(Particle, color)));
+  for (GLuint attribute{}; attribute < 4; ++attribute) {
+    glVertexAttribDivisor(attribute, divisor);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+} // namespace
+
+void ParticleSpawner::build(
+  const std::vector<ParticleEmitter>& emitters,
+  const glm::dvec3& cameraPosition,
+  double deltaTime,
+  ParticleBlock& block
+) {
+  const double step{std::clamp(deltaTime, 0., maxTimeStep)};
+  // Shifted in double, so distant cameras keep their precision.
+  const glm::vec3 shift{started ? glm::vec3{cameraPosition - origin} : glm::vec3{0.f}};
+  origin = cameraPosition;
+  started = true;
+  std::uint32_t emitted{};
+  for (std::size_t i{}; i < maxParticleEmitters; ++i) {
+    ParticleBlock::Emitter& target{block.emitters[i]};
+    if (i >= emitters.size()) {
+      pending[i] = 0.;
+      target = ParticleBlock::Emitter{};
+      continue;
+    }
+    const ParticleEmitter& emitter{emitters[i]};
+    // Fractions carry over, so low rates still emit on average.
+    pending[i] += static_cast<double>(emitter.rate) * step;
+    const std::uint32_t count{std::min(static_cast<std::uint32_t>(pending[i]), capacity - emitted)};
+    pending[i] -= static_cast<double>(count);
+    target = ParticleBlock::Emitter{
+      glm::vec4{emitter.position, emitter.size},
+      glm::vec4{emitter.extent, 0.f},
+      glm::vec4{emitter.velocity, emitter.velocityJitter},
+      emitter.color,
+      glm::vec4{emitter.lifetime, emitter.lifetimeJitter, static_cast<float>(emitted), static_cast<float>(count)}
+    };
+    emitted += count;
+  }
+  block.emission = glm::ivec4{
+    static_cast<int>(cursor),
+    static_cast<int>(emitted),
+    static_cast<int>(capacity),
+    static_cast<int>(seed++)
+  };
+  block.step = glm::vec4{shift, static_cast<float>(step)};
+  // Gravity and air drag, shared by every emitter.
+  block.forces = glm::vec4{0.f, -1.5f, 0.f, .3f};
+  cursor = (cursor + emitted) % capacity;
+}
+
+const std::vector<const char*> ParticleSystem::feedbackVaryings{
+  "nextPositionAge",
+  "nextVelocityLifetime",
+  "nextSize",
+  "nextColor",
+};
+
+ParticleSystem::ParticleSystem(GLResources& resources, GLuint updateProgram, GLuint drawProgram) :
+  resources{resources},
+  updateProgram{updateProgram},
+  drawProgram{drawProgram},
+  viewLocation{glGetUniformLocation(drawProgram, "view")},
+  projectionLocation{glGetUniformLocation(drawProgram, "projection")},
+  memory{resources.memory().track(MemoryCategory::Geometry, 2ull * ParticleSpawner::capacity * sizeof(Particle))} {
+  glUniformBlockBinding(updateProgram, glGetUniformBlockIndex(updateProgram, "ParticleBlock"), blockBinding);
+  // All zero is a dead particle.
+  const std::vector<Particle> dead(ParticleSpawner::capacity, Particle{});
+  for (int i{}; i < 2; ++i) {
+    buffers[i] = resources.createBuffer();
+    const GLuint buffer{resources.get(buffers[i])};
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(dead.size() * sizeof(Particle)), dead.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    updateArrays[i] = resources.createVertexArray();
+    glBindVertexArray(resources.get(updateArrays[i]));
+    setParticleAttributes(buffer, 0);
+    drawArrays[i] = resources.createVertexArray();
+    glBindVertexArray(resources.get(drawArrays[i]));
+    setParticleAttributes(buffer, 1);
+  }
+  glBindVertexArray(0);
+}
+
+ParticleSystem::~ParticleSystem() {
+  for (int i{}; i < 2; ++i) {
+    resources.destroy(drawArrays[i]);
+    resources.destroy(updateArrays[i]);
+    resources.destroy(buffers[i]);
+  }
+  resources.memory().untrack(memory);
+}
+
+void ParticleSystem::update() {
+  const int next{1 - current};
+  glUseProgram(updateProgram);
+  glBindVertexArray(resources.get(updateArrays[current]));
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, resources.get(buffers[next]));
+  glEnable(GL_RASTERIZER_DISCARD);
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(ParticleSpawner::capacity));
+  glEndTransformFeedback();
+  glDisable(GL_RASTERIZER_DISCARD);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  glBindVertexArray(0);
+  glUseProgram(0);
+  current = next;
+}
+
+void ParticleSystem::draw(const glm::mat4& view, const glm::mat4& projection) const {
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  glUseProgram(drawProgram);
+  glUniformMatrix4fv(viewLocation, 1, GL_FALSE, &view[0][0]);
+  glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, &projection[0][0]);
+  glBindVertexArray(resources.get(drawArrays[current]));
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(ParticleSpawner::capacity));
+  glBindVertexArray(0);
+  glUseProgram(0);
+  glDisable(GL_BLEND);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_DEPTH_TEST);
+}
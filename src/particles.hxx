@@ -0,0 +1,118 @@
+#ifndef PARTICLES_HXX
+#define PARTICLES_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "gl_resources.hxx"
+
+// Spawns particles at a steady rate. Camera-relative, like the particles.
+struct ParticleEmitter {
+  glm::vec3 position;
+  // Half size of the box particles spawn in.
+  glm::vec3 extent;
+  glm::vec3 velocity;
+  // Largest random speed added to the velocity, in any direction.
+  float velocityJitter;
+  glm::vec4 color;
+  float size;
+  // Seconds.
+  float lifetime;
+  float lifetimeJitter;
+  // Particles per second.
+  float rate;
+};
+
+constexpr std::size_t maxParticleEmitters{8};
+
+// std140 layout of ParticleBlock in particles_update.vert, uploaded once per
+// frame. It is all the CPU sends: particles live and die on the GPU.
+struct ParticleBlock {
+  struct Emitter {
+    // w: size.
+    glm::vec4 position;
+    glm::vec4 extent;
+    // w: velocity jitter.
+    glm::vec4 velocity;
+    glm::vec4 color;
+    // Lifetime and its jitter, then the emitter's first particle within this
+    // frame's emission and its particle count.
+    glm::vec4 life;
+  };
+
+  std::array<Emitter, maxParticleEmitters> emitters;
+  // First slot emitted into, slots emitted, capacity and random seed.
+  glm::ivec4 emission;
+  // Camera movement since the last update, and the time step.
+  glm::vec4 step;
+  // Acceleration, and drag per second.
+  glm::vec4 forces;
+};
+
+// Main thread side of the particle system. Turns emitter rates into slots
+// of the ring of particles and tracks the camera, since particles are
+// stored relative to it and shifted on the GPU as it moves.
+class ParticleSpawner {
+public:
+  static constexpr std::uint32_t capacity{1u << 20};
+
+  void build(
+    const std::vector<ParticleEmitter>& emitters,
+    const glm::dvec3& cameraPosition,
+    double deltaTime,
+    ParticleBlock& block
+  );
+
+private:
+  std::array<double, maxParticleEmitters> pending{};
+  std::uint32_t cursor{};
+  std::uint32_t seed{};
+  glm::dvec3 origin{};
+  bool started{};
+};
+
+// GPU particle simulation. Each update streams every particle through a
+// vertex shader with rasterization off and captures the result with
+// transform feedback into the other of two buffers; new particles overwrite
+// the oldest slots of the ring. Drawing reads the same buffer as per
+// instance attributes of a billboard, so no particle ever touches the CPU.
+class ParticleSystem {
+public:
+  static constexpr GLuint blockBinding{2};
+
+  // Must be given programs built from particles_update.vert, captured in
+  // the order of feedbackVaryings, and particles.vert and particles.frag.
+  ParticleSystem(GLResources& resources, GLuint updateProgram, GLuint drawProgram);
+  ParticleSystem(const ParticleSystem&) = delete;
+  ParticleSystem& operator=(const ParticleSystem&) = delete;
+  ~ParticleSystem();
+
+  static const std::vector<const char*> feedbackVaryings;
+
+  // Advances from last frame's state; the ParticleBlock must be bound to
+  // blockBinding.
+  void update();
+  // Additive, depth-tested against but not writing the bound depth buffer.
+  void draw(const glm::mat4& view, const glm::mat4& projection) const;
+
+private:
+  GLResources& resources;
+  GLuint updateProgram;
+  GLuint drawProgram;
+  GLint viewLocation;
+  GLint projectionLocation;
+  std::array<BufferHandle, 2> buffers{};
+  // Per buffer: read as vertices for updating, and as instances for drawing.
+  std::array<VertexArrayHandle, 2> updateArrays{};
+  std::array<VertexArrayHandle, 2> drawArrays{};
+  GpuMemoryBudget::Allocation memory;
+  // The buffer holding the latest state.
+  int current{};
+};
+
+#endif // PARTICLES_HXX
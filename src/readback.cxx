@@ -0,0 +1,154 @@
+#include "readback.hxx"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "debug.hxx"
+
+namespace {
+
+constexpr GLuint64 shutdownTimeout{1'000'000'000};
+
+GLsizeiptr imageSize(int width, int height) {
+  return static_cast<GLsizeiptr>(width) * height * 4;
+}
+
+} // namespace
+
+bool writePortablePixmap(const ReadbackImage& image, const std::string& path) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    return false;
+  }
+  file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+  std::vector<char> row(static_cast<std::size_t>(image.width) * 3);
+  for (int y{image.height - 1}; y >= 0; --y) {
+    const std::uint8_t* source{image.pixels.data() + static_cast<std::size_t>(y) * image.width * 4};
+    for (int x{}; x < image.width; ++x) {
+      row[x * 3] = static_cast<char>(source[x * 4]);
+      row[x * 3 + 1] = static_cast<char>(source[x * 4 + 1]);
+      row[x * 3 + 2] = static_cast<char>(source[x * 4 + 2]);
+    }
+    file.write(row.data(), static_cast<std::streamsize>(row.size()));
+  }
+  return static_cast<bool>(file);
+}
+
+FramebufferReadback::FramebufferReadback(GLResources& resources, Consumer consumer) :
+  resources{resources},
+  consumer{std::move(consumer)},
+  encoder{[this]() { encoderLoop(); }} {
+  for (Slot& slot : slots) {
+    slot.buffer = resources.createBuffer();
+    slot.memory = resources.memory().track(MemoryCategory::Stream, 0);
+  }
+}
+
+FramebufferReadback::~FramebufferReadback() {
+  for (; inFlight > 0; --inFlight) {
+    Slot& slot{slots[next]};
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, shutdownTimeout);
+    map(slot);
+    next = (next + 1) % bufferCount;
+  }
+  {
+    const std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  wake.notify_one();
+  encoder.join();
+  for (Slot& slot : slots) {
+    resources.memory().untrack(slot.memory);
+    resources.destroy(slot.buffer);
+  }
+}
+
+bool FramebufferReadback::request(int width, int height) {
+  if (inFlight == bufferCount || width <= 0 || height <= 0) {
+    DEBUG_ERROR_LINE("Readback: request dropped");
+    return false;
+  }
+  Slot& slot{slots[(next + inFlight) % bufferCount]};
+  const GLsizeiptr size{imageSize(width, height)};
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, resources.get(slot.buffer));
+  if (size > slot.capacity) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    slot.capacity = size;
+    resources.memory().resize(slot.memory, static_cast<std::uint64_t>(size));
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glReadBuffer(GL_BACK);
+  // With a pack buffer bound the copy is queued on the GPU and returns at once.
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.width = width;
+  slot.height = height;
+  ++inFlight;
+  return true;
+}
+
+void FramebufferReadback::poll() {
+  // Fences signal in order, so stop at the first one still pending.
+  while (inFlight > 0) {
+    Slot& slot{slots[next]};
+    const GLenum status{glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)};
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return;
+    }
+    map(slot);
+    next = (next + 1) % bufferCount;
+    --inFlight;
+  }
+}
+
+void FramebufferReadback::map(Slot& slot) {
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+  ReadbackImage image{};
+  {
+    const std::lock_guard lock{mutex};
+    if (!freeImages.empty()) {
+      image = std::move(freeImages.back());
+      freeImages.pop_back();
+    }
+  }
+  const GLsizeiptr size{imageSize(slot.width, slot.height)};
+  image.width = slot.width;
+  image.height = slot.height;
+  image.pixels.resize(static_cast<std::size_t>(size));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, resources.get(slot.buffer));
+  const void* data{glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT)};
+  if (data) {
+    std::memcpy(image.pixels.data(), data, image.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (!data) {
+    DEBUG_ERROR_LINE("Readback: mapping failed");
+    return;
+  }
+  {
+    const std::lock_guard lock{mutex};
+    queued.push_back(std::move(image));
+  }
+  wake.notify_one();
+}
+
+void FramebufferReadback::encoderLoop() {
+  std::unique_lock lock{mutex};
+  for (;;) {
+    wake.wait(lock, [this]() { return stopping || !queued.empty(); });
+    if (queued.empty()) {
+      return;
+    }
+    ReadbackImage image{std::move(queued.front())};
+    queued.pop_front();
+    lock.unlock();
+    consumer(image);
+    lock.lock();
+    freeImages.push_back(std::move(image));
+  }
+}
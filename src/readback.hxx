@@ -0,0 +1,83 @@
+#ifndef READBACK_HXX
+#define READBACK_HXX
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+
+// Tightly packed RGBA8 rows, bottom row first as GL returns them.
+struct ReadbackImage {
+  int width;
+  int height;
+  std::vector<std::uint8_t> pixels;
+};
+
+// Writes a binary PPM, flipped upright and without alpha.
+bool writePortablePixmap(const ReadbackImage& image, const std::string& path);
+
+// Asynchronous framebuffer readback. request() reads the back buffer into
+// one of a ring of pixel pack buffers and fences it; poll() maps the buffers
+// whose fence has signaled, normally a couple of frames later, and hands a
+// copy to an encoder thread that calls the consumer. The render thread never
+// waits on the GPU or on encoding: with every buffer in flight a request is
+// dropped instead.
+class FramebufferReadback {
+public:
+  static constexpr int bufferCount{3};
+
+  using Consumer = std::function<void(const ReadbackImage&)>;
+
+  // The consumer runs on the encoder thread.
+  FramebufferReadback(GLResources& resources, Consumer consumer);
+  FramebufferReadback(const FramebufferReadback&) = delete;
+  FramebufferReadback& operator=(const FramebufferReadback&) = delete;
+  // Completes readbacks still in flight, waiting for the GPU if it has to,
+  // and for the encoder to drain.
+  ~FramebufferReadback();
+
+  // Call after the frame is drawn and before it is swapped. Returns false
+  // when the request was dropped.
+  bool request(int width, int height);
+  // Call once per frame. Never blocks on the GPU.
+  void poll();
+
+private:
+  struct Slot {
+    BufferHandle buffer;
+    GpuMemoryBudget::Allocation memory;
+    GLsizeiptr capacity;
+    GLsync fence;
+    int width;
+    int height;
+  };
+
+  void map(Slot& slot);
+  void encoderLoop();
+
+  GLResources& resources;
+  Consumer consumer;
+  std::array<Slot, bufferCount> slots{};
+  // Slots in flight are next, next + 1, ... in request order.
+  int next{};
+  int inFlight{};
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  std::deque<ReadbackImage> queued{};
+  // Encoded images come back here so that capturing every frame reuses
+  // their pixel storage.
+  std::vector<ReadbackImage> freeImages{};
+  bool stopping{};
+  std::thread encoder;
+};
+
+#endif // READBACK_HXX
@@ -0,0 +1,357 @@
+#include "render_graph.hxx"
+
+#include <algorithm>
+
+#include "debug.hxx"
+
+namespace {
+
+bool isDepthStencil(GLenum internalFormat) {
+  return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
+}
+
+bool isDepth(GLenum internalFormat) {
+  switch (internalFormat) {
+  case GL_DEPTH_COMPONENT16:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32:
+  case GL_DEPTH_COMPONENT32F:
+    return true;
+  default:
+    return isDepthStencil(internalFormat);
+  }
+}
+
+// Any format and type valid for the internal format; no data is uploaded.
+void pixelTransfer(GLenum internalFormat, GLenum& format, GLenum& type) {
+  if (isDepthStencil(internalFormat)) {
+    format = GL_DEPTH_STENCIL;
+    type = GL_UNSIGNED_INT_24_8;
+  } else if (isDepth(internalFormat)) {
+    format = GL_DEPTH_COMPONENT;
+    type = GL_FLOAT;
+  } else {
+    format = GL_RGBA;
+    type = GL_UNSIGNED_BYTE;
+  }
+}
+
+} // namespace
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(Resource resource) {
+  graph.access(pass, resource, Access::Read);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(Resource resource) {
+  graph.access(pass, resource, Access::Write);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::colorAttachment(Resource resource) {
+  graph.access(pass, resource, Access::Color);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::depthAttachment(Resource resource) {
+  graph.access(pass, resource, Access::Depth);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect() {
+  graph.passes[pass].sideEffect = true;
+  return *this;
+}
+
+RenderGraph::RenderGraph(GLResources& resources) :
+  glResources{resources} {}
+
+RenderGraph::~RenderGraph() {
+  for (const Framebuffer& framebuffer : framebuffers) {
+    glResources.destroy(framebuffer.framebuffer);
+  }
+  for (const Target& target : targets) {
+    glResources.memory().untrack(target.memory);
+    glResources.destroy(target.texture);
+  }
+}
+
+void RenderGraph::reset() {
+  resources.clear();
+  accesses.clear();
+  passes.clear();
+  executionOrder.clear();
+}
+
+RenderGraph::Resource RenderGraph::importBackbuffer(GLsizei width, GLsizei height) {
+  return addResource(ResourceNode{
+    "backbuffer", ResourceKind::Backbuffer, RenderTargetDesc{GL_RGBA8, width, height}, {}, {}, none, none
+  });
+}
+
+RenderGraph::Resource RenderGraph::importTexture(const char* name, TextureHandle texture, const RenderTargetDesc& desc) {
+  return addResource(ResourceNode{name, ResourceKind::ImportedTexture, desc, texture, {}, none, none});
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const char* name, BufferHandle buffer) {
+  return addResource(ResourceNode{name, ResourceKind::ImportedBuffer, RenderTargetDesc{}, {}, buffer, none, none});
+}
+
+RenderGraph::Resource RenderGraph::createTarget(const char* name, const RenderTargetDesc& desc) {
+  return addResource(ResourceNode{name, ResourceKind::Transient, desc, {}, {}, none, none});
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name, PassFunction function, const void* data) {
+  const std::uint32_t pass{static_cast<std::uint32_t>(passes.size())};
+  passes.push_back(PassNode{
+    name,
+    function,
+    data,
+    static_cast<std::uint32_t>(accesses.size()),
+    0,
+    false,
+    false,
+    none,
+    false,
+    0,
+    0
+  });
+  return PassBuilder{*this, pass};
+}
+
+RenderGraph::Resource RenderGraph::addResource(const ResourceNode& node) {
+  resources.push_back(node);
+  return static_cast<Resource>(resources.size() - 1);
+}
+
+void RenderGraph::access(std::uint32_t pass, Resource resource, Access access) {
+  PassNode& node{passes[pass]};
+  // Accesses are stored per pass, so a pass must be complete before the next.
+  if (node.firstAccess + node.accessCount != accesses.size()) {
+    DEBUG_ERROR_LINE("Render graph: " << node.name << " declared after a later pass");
+    return;
+  }
+  accesses.push_back(AccessNode{resource, access});
+  ++node.accessCount;
+}
+
+void RenderGraph::compile() {
+  // Culled back to front. Imported resources outlive the frame, so their
+  // writers always live. Attachments are loaded rather than cleared, so
+  // drawing into one keeps its earlier writers alive too.
+  needed.assign(resources.size(), false);
+  for (std::size_t pass{passes.size()}; pass-- > 0;) {
+    PassNode& node{passes[pass]};
+    node.live = node.sideEffect;
+    for (std::uint32_t i{node.firstAccess}; i < node.firstAccess + node.accessCount && !node.live; ++i) {
+      const AccessNode& access{accesses[i]};
+      node.live = access.access != Access::Read
+        && (needed[access.resource] || resources[access.resource].kind != ResourceKind::Transient);
+    }
+    if (!node.live) {
+      continue;
+    }
+    for (std::uint32_t i{node.firstAccess}; i < node.firstAccess + node.accessCount; ++i) {
+      if (accesses[i].access != Access::Write) {
+        needed[accesses[i].resource] = true;
+      }
+    }
+  }
+  executionOrder.clear();
+  for (std::uint32_t pass{}; pass < passes.size(); ++pass) {
+    if (!passes[pass].live) {
+      continue;
+    }
+    const std::uint32_t index{static_cast<std::uint32_t>(executionOrder.size())};
+    executionOrder.push_back(pass);
+    const PassNode& node{passes[pass]};
+    for (std::uint32_t i{node.firstAccess}; i < node.firstAccess + node.accessCount; ++i) {
+      ResourceNode& resource{resources[accesses[i].resource]};
+      if (resource.firstUse == none) {
+        resource.firstUse = index;
+      }
+      resource.lastUse = index;
+    }
+  }
+  // Placing in order of first use lets a target take over a texture whose
+  // previous tenant is already dead.
+  placementOrder.clear();
+  for (Resource resource{}; resource < resources.size(); ++resource) {
+    if (resources[resource].kind == ResourceKind::Transient && resources[resource].firstUse != none) {
+      placementOrder.push_back(resource);
+    }
+  }
+  std::sort(placementOrder.begin(), placementOrder.end(), [this](Resource left, Resource right) {
+    return resources[left].firstUse < resources[right].firstUse;
+  });
+  for (Target& target : targets) {
+    target.used = false;
+  }
+  for (const Resource resource : placementOrder) {
+    ResourceNode& node{resources[resource]};
+    node.texture = targets[placeTarget(node.desc, node.firstUse, node.lastUse)].texture;
+  }
+  releaseUnusedTargets();
+  for (const std::uint32_t pass : executionOrder) {
+    PassNode& node{passes[pass]};
+    Framebuffer attachments{};
+    bool attached{};
+    for (std::uint32_t i{node.firstAccess}; i < node.firstAccess + node.accessCount; ++i) {
+      const AccessNode& access{accesses[i]};
+      if (access.access != Access::Color && access.access != Access::Depth) {
+        continue;
+      }
+      const ResourceNode& resource{resources[access.resource]};
+      attached = true;
+      node.width = resource.desc.width;
+      node.height = resource.desc.height;
+      if (resource.kind == ResourceKind::Backbuffer) {
+        node.backbuffer = true;
+      } else if (access.access == Access::Depth) {
+        attachments.depth = resource.texture;
+        attachments.depthStencil = isDepthStencil(resource.desc.internalFormat);
+      } else if (attachments.colorCount < maxColorAttachments) {
+        attachments.color[attachments.colorCount++] = resource.texture;
+      } else {
+        DEBUG_ERROR_LINE("Render graph: " << node.name << " has too many color attachments");
+      }
+    }
+    if (node.backbuffer && (attachments.colorCount > 0 || attachments.depth)) {
+      DEBUG_ERROR_LINE("Render graph: " << node.name << " mixes the backbuffer with other targets");
+    }
+    node.framebuffer = attached && !node.backbuffer ? findFramebuffer(attachments) : none;
+  }
+}
+
+void RenderGraph::execute() const {
+  for (const std::uint32_t pass : executionOrder) {
+    const PassNode& node{passes[pass]};
+    if (node.backbuffer || node.framebuffer != none) {
+      const GLuint framebuffer{node.backbuffer ? 0 : glResources.get(framebuffers[node.framebuffer].framebuffer)};
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+      glViewport(0, 0, node.width, node.height);
+    }
+    node.function(node.data, *this);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint RenderGraph::texture(Resource resource) const {
+  return glResources.get(resources[resource].texture);
+}
+
+GLuint RenderGraph::buffer(Resource resource) const {
+  return glResources.get(resources[resource].buffer);
+}
+
+std::uint32_t RenderGraph::placeTarget(const RenderTargetDesc& desc, std::uint32_t firstUse, std::uint32_t lastUse) {
+  for (std::uint32_t i{}; i < targets.size(); ++i) {
+    Target& target{targets[i]};
+    if (target.desc == desc && (!target.used || target.busyUntil < firstUse)) {
+      target.used = true;
+      target.busyUntil = lastUse;
+      return i;
+    }
+  }
+  Target target{
+    desc,
+    glResources.createTexture(),
+    glResources.memory().track(
+      MemoryCategory::RenderTarget,
+      textureMemorySize(desc.internalFormat, desc.width, desc.height, 1, 1)
+    ),
+    lastUse,
+    true
+  };
+  GLenum format{};
+  GLenum type{};
+  pixelTransfer(desc.internalFormat, format, type);
+  glBindTexture(GL_TEXTURE_2D, glResources.get(target.texture));
+  glTexImage2D(
+    GL_TEXTURE_2D,
+    0,
+    static_cast<GLint>(desc.internalFormat),
+    desc.width,
+    desc.height,
+    0 /*border*/,
+    format,
+    type,
+    nullptr
+  );
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  DEBUG_LOG_LINE("Render graph: " << desc.width << 'x' << desc.height << " target created");
+  targets.push_back(target);
+  return static_cast<std::uint32_t>(targets.size() - 1);
+}
+
+std::uint32_t RenderGraph::findFramebuffer(const Framebuffer& attachments) {
+  for (std::uint32_t i{}; i < framebuffers.size(); ++i) {
+    const Framebuffer& framebuffer{framebuffers[i]};
+    if (framebuffer.colorCount == attachments.colorCount
+        && framebuffer.depth == attachments.depth
+        && std::equal(attachments.color.begin(), attachments.color.begin() + attachments.colorCount, framebuffer.color.begin())) {
+      return i;
+    }
+  }
+  Framebuffer framebuffer{attachments};
+  framebuffer.framebuffer = glResources.createFramebuffer();
+  glBindFramebuffer(GL_FRAMEBUFFER, glResources.get(framebuffer.framebuffer));
+  std::array<GLenum, maxColorAttachments> drawBuffers{};
+  for (std::uint32_t i{}; i < framebuffer.colorCount; ++i) {
+    drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[i], GL_TEXTURE_2D, glResources.get(framebuffer.color[i]), 0);
+  }
+  if (framebuffer.depth) {
+    glFramebufferTexture2D(
+      GL_FRAMEBUFFER,
+      framebuffer.depthStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+      GL_TEXTURE_2D,
+      glResources.get(framebuffer.depth),
+      0
+    );
+  }
+  // Draw buffers are framebuffer state, so they are set once here.
+  if (framebuffer.colorCount > 0) {
+    glDrawBuffers(static_cast<GLsizei>(framebuffer.colorCount), drawBuffers.data());
+  } else {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+#ifdef DEBUG
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    DEBUG_ERROR_LINE("Render graph: incomplete framebuffer");
+  }
+#endif
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  framebuffers.push_back(framebuffer);
+  return static_cast<std::uint32_t>(framebuffers.size() - 1);
+}
+
+void RenderGraph::releaseUnusedTargets() {
+  for (std::size_t i{targets.size()}; i-- > 0;) {
+    const Target target{targets[i]};
+    if (target.used) {
+      continue;
+    }
+    for (std::size_t j{framebuffers.size()}; j-- > 0;) {
+      const Framebuffer& framebuffer{framebuffers[j]};
+      const bool attached{
+        framebuffer.depth == target.texture
+        || std::find(framebuffer.color.begin(), framebuffer.color.begin() + framebuffer.colorCount, target.texture)
+          != framebuffer.color.begin() + framebuffer.colorCount
+      };
+      if (attached) {
+        glResources.destroy(framebuffer.framebuffer);
+        framebuffers.erase(framebuffers.begin() + static_cast<std::ptrdiff_t>(j));
+      }
+    }
+    glResources.memory().untrack(target.memory);
+    glResources.destroy(target.texture);
+    targets.erase(targets.begin() + static_cast<std::ptrdiff_t>(i));
+  }
+}
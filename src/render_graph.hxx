@@ -0,0 +1,179 @@
+#ifndef RENDER_GRAPH_HXX
+#define RENDER_GRAPH_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+
+struct RenderTargetDesc {
+  GLenum internalFormat;
+  GLsizei width;
+  GLsizei height;
+
+  bool operator==(const RenderTargetDesc& other) const {
+    return internalFormat == other.internalFormat && width == other.width && height == other.height;
+  }
+};
+
+// Frame graph, declared anew every frame. Passes declare the resources they
+// read and the targets they render to; compile() culls passes that nothing
+// depends on, gives every transient target a texture and finds each pass a
+// framebuffer, and execute() binds it before running the pass.
+//
+// Declaration order is execution order: a pass can only read what passes
+// declared before it wrote. Transient targets with the same description
+// whose lifetimes do not overlap share one texture, and textures and
+// framebuffers are kept across frames, so a steady frame creates no GL
+// objects.
+class RenderGraph {
+public:
+  using Resource = std::uint32_t;
+  using PassFunction = void (*)(const void* data, const RenderGraph& graph);
+
+  static constexpr std::size_t maxColorAttachments{4};
+
+  class PassBuilder {
+  public:
+    PassBuilder& read(Resource resource);
+    // For buffers and other writes that are not attachments.
+    PassBuilder& write(Resource resource);
+    PassBuilder& colorAttachment(Resource resource);
+    PassBuilder& depthAttachment(Resource resource);
+    // Keeps the pass even if nothing reads what it writes.
+    PassBuilder& sideEffect();
+
+  private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph& graph, std::uint32_t pass) : graph{graph}, pass{pass} {}
+
+    RenderGraph& graph;
+    std::uint32_t pass;
+  };
+
+  explicit RenderGraph(GLResources& resources);
+  RenderGraph(const RenderGraph&) = delete;
+  RenderGraph& operator=(const RenderGraph&) = delete;
+  ~RenderGraph();
+
+  // Starts declaring a new frame.
+  void reset();
+  // The default framebuffer, color and depth together.
+  Resource importBackbuffer(GLsizei width, GLsizei height);
+  // A texture the graph neither owns nor recycles, such as a cached target.
+  Resource importTexture(const char* name, TextureHandle texture, const RenderTargetDesc& desc);
+  Resource importBuffer(const char* name, BufferHandle buffer);
+  Resource createTarget(const char* name, const RenderTargetDesc& desc);
+
+  // The function is called by reference from execute(), so it must be a
+  // named object that outlives it.
+  template <typename Function>
+  PassBuilder addPass(const char* name, const Function& function) {
+    const PassFunction trampoline{[](const void* data, const RenderGraph& graph) {
+      (*static_cast<const Function*>(data))(graph);
+    }};
+    return addPass(name, trampoline, &function);
+  }
+  template <typename Function>
+  PassBuilder addPass(const char* name, const Function&& function) = delete;
+  PassBuilder addPass(const char* name, PassFunction function, const void* data);
+
+  void compile();
+  void execute() const;
+
+  // Valid from compile() on; for passes that sample their inputs.
+  GLuint texture(Resource resource) const;
+  GLuint buffer(Resource resource) const;
+  const RenderTargetDesc& desc(Resource resource) const { return resources[resource].desc; }
+  std::size_t livePassCount() const { return executionOrder.size(); }
+  std::size_t targetTextureCount() const { return targets.size(); }
+
+private:
+  enum class ResourceKind : std::uint8_t {
+    Backbuffer,
+    ImportedTexture,
+    ImportedBuffer,
+    Transient,
+  };
+
+  enum class Access : std::uint8_t {
+    Read,
+    Write,
+    Color,
+    Depth,
+  };
+
+  struct ResourceNode {
+    const char* name;
+    ResourceKind kind;
+    RenderTargetDesc desc;
+    TextureHandle texture;
+    BufferHandle buffer;
+    // Execution indices of the first and last live pass using a transient.
+    std::uint32_t firstUse;
+    std::uint32_t lastUse;
+  };
+
+  struct AccessNode {
+    Resource resource;
+    Access access;
+  };
+
+  struct PassNode {
+    const char* name;
+    PassFunction function;
+    const void* data;
+    std::uint32_t firstAccess;
+    std::uint32_t accessCount;
+    bool sideEffect;
+    bool live;
+    // Index into framebuffers, or none when the pass renders to the
+    // backbuffer or declares no attachments.
+    std::uint32_t framebuffer;
+    bool backbuffer;
+    GLsizei width;
+    GLsizei height;
+  };
+
+  // Persistent texture that transient targets are placed in.
+  struct Target {
+    RenderTargetDesc desc;
+    TextureHandle texture;
+    GpuMemoryBudget::Allocation memory;
+    // Execution index after which it is free again this frame.
+    std::uint32_t busyUntil;
+    bool used;
+  };
+
+  struct Framebuffer {
+    FramebufferHandle framebuffer;
+    std::uint32_t colorCount;
+    std::array<TextureHandle, maxColorAttachments> color;
+    TextureHandle depth;
+    bool depthStencil;
+  };
+
+  static constexpr std::uint32_t none{~std::uint32_t{}};
+
+  Resource addResource(const ResourceNode& node);
+  void access(std::uint32_t pass, Resource resource, Access access);
+  std::uint32_t placeTarget(const RenderTargetDesc& desc, std::uint32_t firstUse, std::uint32_t lastUse);
+  std::uint32_t findFramebuffer(const Framebuffer& attachments);
+  void releaseUnusedTargets();
+
+  GLResources& glResources;
+  std::vector<ResourceNode> resources{};
+  std::vector<AccessNode> accesses{};
+  std::vector<PassNode> passes{};
+  std::vector<std::uint32_t> executionOrder{};
+  std::vector<bool> needed{};
+  std::vector<Resource> placementOrder{};
+  std::vector<Target> targets{};
+  std::vector<Framebuffer> framebuffers{};
+};
+
+#endif // RENDER_GRAPH_HXX
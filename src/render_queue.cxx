@@ -0,0 +1,104 @@
+#include "render_queue.hxx"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr int passBits{4};
+constexpr int translucencyBits{2};
+constexpr int programBits{10};
+constexpr int materialBits{14};
+constexpr int vaoBits{10};
+constexpr int depthBits{24};
+static_assert(
+  passBits + translucencyBits + programBits + materialBits + vaoBits + depthBits == 64,
+  "Draw key fields must fill 64 bits"
+);
+
+constexpr std::uint64_t mask(int bits) {
+  return (std::uint64_t{1} << bits) - 1;
+}
+
+std::uint64_t quantizeDepth(float depth) {
+  const float clamped{std::clamp(depth, 0.f, 1.f)};
+  return static_cast<std::uint64_t>(clamped * static_cast<float>(mask(depthBits)));
+}
+
+} // namespace
+
+std::uint64_t makeDrawKey(const DrawKeyFields& fields) {
+  const std::uint64_t pass{static_cast<std::uint64_t>(fields.pass) & mask(passBits)};
+  const std::uint64_t translucency{static_cast<std::uint64_t>(fields.translucency) & mask(translucencyBits)};
+  const std::uint64_t program{fields.program & mask(programBits)};
+  const std::uint64_t material{fields.material & mask(materialBits)};
+  const std::uint64_t vao{fields.vao & mask(vaoBits)};
+  const std::uint64_t depth{quantizeDepth(fields.depth)};
+  std::uint64_t key{pass};
+  key = (key << translucencyBits) | translucency;
+  if (fields.translucency == Translucency::Translucent) {
+    key = (key << depthBits) | (~depth & mask(depthBits));
+    key = (key << programBits) | program;
+    key = (key << materialBits) | material;
+    key = (key << vaoBits) | vao;
+  } else {
+    key = (key << programBits) | program;
+    key = (key << materialBits) | material;
+    key = (key << vaoBits) | vao;
+    key = (key << depthBits) | depth;
+  }
+  return key;
+}
+
+RenderQueue::RenderQueue(std::pmr::memory_resource* resource) :
+  queue{resource},
+  scratch{resource} {}
+
+void RenderQueue::clear() {
+  queue.clear();
+}
+
+void RenderQueue::reserve(std::size_t count) {
+  queue.reserve(count);
+  scratch.reserve(count);
+}
+
+void RenderQueue::submit(std::uint64_t key, std::uint32_t payload) {
+  queue.push_back(RenderItem{key, payload});
+}
+
+void RenderQueue::sort() {
+  constexpr int radixBits{8};
+  constexpr std::size_t bucketCount{std::size_t{1} << radixBits};
+  constexpr int passCount{64 / radixBits};
+  const std::size_t count{queue.size()};
+  if (count < 2) {
+    return;
+  }
+  // Build every byte histogram in a single sweep over the keys.
+  std::array<std::array<std::size_t, bucketCount>, passCount> histograms{};
+  for (const RenderItem& item : queue) {
+    for (int pass{}; pass < passCount; ++pass) {
+      ++histograms[pass][(item.key >> (pass * radixBits)) & (bucketCount - 1)];
+    }
+  }
+  scratch.resize(count);
+  for (int pass{}; pass < passCount; ++pass) {
+    std::array<std::size_t, bucketCount>& histogram{histograms[pass]};
+    const int shift{pass * radixBits};
+    const std::size_t firstBucket{(queue.front().key >> shift) & (bucketCount - 1)};
+    if (histogram[firstBucket] == count) {
+      continue;
+    }
+    std::size_t offset{};
+    for (std::size_t& bucket : histogram) {
+      const std::size_t bucketSize{bucket};
+      bucket = offset;
+      offset += bucketSize;
+    }
+    for (const RenderItem& item : queue) {
+      scratch[histogram[(item.key >> shift) & (bucketCount - 1)]++] = item;
+    }
+    queue.swap(scratch);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef RENDER_QUEUE_HXX
+#define RENDER_QUEUE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+enum class RenderPass : std::uint8_t {
+  Main = 0,
+  Overlay = 1,
+};
+
+enum class Translucency : std::uint8_t {
+  Opaque = 0,
+  Cutout = 1,
+  Translucent = 2,
+};
+
+// Sort fields for a single draw. Program, material and VAO are sort hints
+// only: they are masked to fit the key, so two different objects may share
+// an ID and merely cost a redundant bind during submission.
+struct DrawKeyFields {
+  RenderPass pass{RenderPass::Main};
+  Translucency translucency{Translucency::Opaque};
+  std::uint32_t program{};
+  std::uint32_t material{};
+  std::uint32_t vao{};
+  // View depth normalized to [0, 1], where 0 is the near plane.
+  float depth{};
+};
+
+// Key layout, from the most significant bit:
+//   opaque/cutout: pass:4 | translucency:2 | program:10 | material:14 | vao:10 | depth:24
+//   translucent:   pass:4 | translucency:2 | ~depth:24 | program:10 | material:14 | vao:10
+// Opaque draws group by state and go front-to-back within a state bucket;
+// translucent draws go strictly back-to-front.
+std::uint64_t makeDrawKey(const DrawKeyFields& fields);
+
+struct RenderItem {
+  std::uint64_t key;
+  std::uint32_t payload;
+};
+
+class RenderQueue {
+public:
+  explicit RenderQueue(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  void clear();
+  void reserve(std::size_t count);
+  void submit(std::uint64_t key, std::uint32_t payload);
+  // Stable LSD radix sort over the 8 key bytes. Bytes that are identical in
+  // every key are skipped, so a typical frame runs far fewer than 8 passes.
+  void sort();
+  const std::pmr::vector<RenderItem>& items() const { return queue; }
+
+private:
+  std::pmr::vector<RenderItem> queue;
+  std::pmr::vector<RenderItem> scratch;
+};
+
+#endif // RENDER_QUEUE_HXX
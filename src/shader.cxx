@@ -0,0 +1,89 @@
+#include "shader.hxx"
+
+#include <array>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+
+#include "debug.hxx"
+
+std::string readFile(const char* const fileName) {
+  std::ifstream streamIn{fileName};
+  std::ostringstream streamOut{};
+  std::string s{};
+  while (std::getline(streamIn, s)) {
+    streamOut << s << '\n';
+  }
+  return streamOut.str();
+}
+
+GLuint createShader(GLenum type, const std::string& source) {
+  GLuint shader{glCreateShader(type)};
+  std::array<const char*, 1> sources{source.data()};
+  glShaderSource(shader, 1, sources.data(), nullptr /*length*/);
+  glCompileShader(shader);
+  return shader;
+}
+
+namespace {
+
+// Links the program and releases its shaders, which it no longer needs.
+GLuint linkProgram(GLuint program, std::initializer_list<GLuint> shaders) {
+  for (GLuint shader : shaders) {
+    glAttachShader(program, shader);
+  }
+  glLinkProgram(program);
+  GLint status{};
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+#ifdef DEBUG
+  if (!status) {
+    GLsizei programLogLength{};
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &programLogLength);
+    std::string programLog{};
+    programLog.resize(programLogLength);
+    glGetProgramInfoLog(program, programLogLength, &programLogLength, programLog.data());
+    DEBUG_ERROR_LINE("GL program error: " << programLog);
+    for (GLuint shader : shaders) {
+      GLint type{};
+      glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+      GLsizei shaderLogLength{};
+      glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &shaderLogLength);
+      if (shaderLogLength > 0) {
+        std::string shaderLog{};
+        shaderLog.resize(shaderLogLength);
+        glGetShaderInfoLog(shader, shaderLogLength, &shaderLogLength, shaderLog.data());
+        DEBUG_ERROR_LINE("GL " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader error: " << shaderLog);
+      }
+    }
+  }
+#endif
+  for (GLuint shader : shaders) {
+    glDetachShader(program, shader);
+    glDeleteShader(shader);
+  }
+  if (!status) {
+    throw std::runtime_error{"Error creating GL program"};
+  }
+  return program;
+}
+
+} // namespace
+
+GLuint createProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+  GLuint vertexShader{createShader(GL_VERTEX_SHADER, vertexSource)};
+  GLuint fragmentShader{createShader(GL_FRAGMENT_SHADER, fragmentSource)};
+  return linkProgram(glCreateProgram(), {vertexShader, fragmentShader});
+}
+
+GLuint createTransformFeedbackProgram(const std::string& vertexSource, const std::vector<const char*>& varyings) {
+  GLuint vertexShader{createShader(GL_VERTEX_SHADER, vertexSource)};
+  GLuint program{glCreateProgram()};
+  glTransformFeedbackVaryings(
+    program,
+    static_cast<GLsizei>(varyings.size()),
+    varyings.data(),
+    GL_INTERLEAVED_ATTRIBS
+  );
+  return linkProgram(program, {vertexShader});
+}
@@ -0,0 +1,16 @@
+#ifndef SHADER_HXX
+#define SHADER_HXX
+
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+std::string readFile(const char* const fileName);
+GLuint createShader(GLenum type, const std::string& source);
+GLuint createProgram(const std::string& vertexSource, const std::string& fragmentSource);
+// Vertex-only program whose outputs are captured, interleaved in the given
+// order, into transform feedback buffer 0.
+GLuint createTransformFeedbackProgram(const std::string& vertexSource, const std::vector<const char*>& varyings);
+
+#endif // SHADER_HXX
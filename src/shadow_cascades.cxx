@@ -0,0 +1,166 @@
+#include "shadow_cascades.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "debug.hxx"
+
+namespace {
+
+// Splits between the near plane and the shadow distance.
+float splitDepth(float nearPlane, float farPlane, int split) {
+  const float fraction{static_cast<float>(split) / static_cast<float>(ShadowCascades::cascadeCount)};
+  const float logarithmic{nearPlane * std::pow(farPlane / nearPlane, fraction)};
+  const float uniform{nearPlane + (farPlane - nearPlane) * fraction};
+  return ShadowCascades::splitLambda * logarithmic + (1.f - ShadowCascades::splitLambda) * uniform;
+}
+
+double snap(double value, double step) {
+  return std::floor(value / step) * step;
+}
+
+} // namespace
+
+void ShadowCascades::update(const Camera& camera, float aspectRatio, const glm::dvec3& lightDirection) {
+  const bool lightChanged{lightDirection != cachedLightDirection};
+  cachedLightDirection = lightDirection;
+  const glm::dvec3 up{std::abs(lightDirection.y) > .99 ? glm::dvec3{0., 0., 1.} : glm::dvec3{0., 1., 0.}};
+  const glm::dmat3 lightRotation{glm::lookAt(glm::dvec3{0.}, -lightDirection, up)};
+  const glm::dvec3 cameraPosition{lightRotation * camera.position};
+  const glm::dvec3 forward{camera.forward()};
+  // Squared distance of a frustum corner from the view axis, per unit depth.
+  const double tanHalfFov{std::tan(static_cast<double>(camera.fieldOfView) * .5)};
+  const double spread{tanHalfFov * tanHalfFov * (1. + static_cast<double>(aspectRatio * aspectRatio))};
+  const float nearPlane{camera.nearPlane};
+  const float farPlane{std::min(shadowDistance, camera.farPlane)};
+  for (int i{}; i < cascadeCount; ++i) {
+    const double sliceNear{splitDepth(nearPlane, farPlane, i)};
+    const double sliceFar{splitDepth(nearPlane, farPlane, i + 1)};
+    // The smallest sphere around the slice's corners is centered on the view
+    // axis; it depends only on the slice and the projection.
+    const double centerDepth{std::min(sliceFar, (sliceFar + sliceNear) * (1. + spread) * .5)};
+    const double radius{std::sqrt(std::max(
+      sliceFar * sliceFar * spread + (sliceFar - centerDepth) * (sliceFar - centerDepth),
+      sliceNear * sliceNear * spread + (centerDepth - sliceNear) * (centerDepth - sliceNear)
+    ))};
+    const glm::dvec3 center{lightRotation * (camera.position + forward * centerDepth)};
+    const bool cachable{i >= firstCachedCascade};
+    const double extent{cachable ? radius * (1. + static_cast<double>(cacheMargin)) : radius};
+    const double texel{2. * extent / static_cast<double>(mapSize)};
+    const glm::dvec3 snapped{snap(center.x, texel), snap(center.y, texel), center.z};
+    CachedRegion& region{cached[i]};
+    bool render{true};
+    if (cachable) {
+      const glm::dvec3 offset{glm::abs(center - region.center)};
+      const bool contained{
+        region.extent == extent && std::max({offset.x, offset.y, offset.z}) + radius <= region.extent
+      };
+      render = !region.valid || lightChanged || !contained || region.movableCaster;
+    }
+    if (render) {
+      region = CachedRegion{snapped, extent, true, false};
+    }
+    // Built in double around the camera, like every other matrix.
+    glm::mat4 lightView{glm::mat3{lightRotation}};
+    lightView[3] = glm::vec4{glm::vec3{cameraPosition - region.center}, 1.f};
+    const float bound{static_cast<float>(region.extent)};
+    cascades[i] = ShadowCascade{
+      glm::ortho(-bound, bound, -bound, bound, -bound, bound) * lightView,
+      static_cast<float>(sliceFar),
+      render
+    };
+  }
+}
+
+void ShadowCascades::invalidate() {
+  for (CachedRegion& region : cached) {
+    region.valid = false;
+  }
+}
+
+bool ShadowCascades::overlaps(int cascade, const BoundingBox& relativeBounds) const {
+  const glm::mat4& lightProjection{cascades[cascade].lightProjection};
+  glm::vec3 low{std::numeric_limits<float>::max()};
+  glm::vec3 high{std::numeric_limits<float>::lowest()};
+  for (int corner{}; corner < 8; ++corner) {
+    const glm::vec4 position{
+      corner & 1 ? relativeBounds.max.x : relativeBounds.min.x,
+      corner & 2 ? relativeBounds.max.y : relativeBounds.min.y,
+      corner & 4 ? relativeBounds.max.z : relativeBounds.min.z,
+      1.f
+    };
+    const glm::vec3 clip{lightProjection * position};
+    low = glm::min(low, clip);
+    high = glm::max(high, clip);
+  }
+  // Casters between the light and the near plane still cast; depth clamping
+  // flattens them onto it.
+  return high.x >= -1.f && low.x <= 1.f && high.y >= -1.f && low.y <= 1.f && low.z <= 1.f;
+}
+
+void ShadowCascades::markMovableCaster(int cascade) {
+  cascades[cascade].render = true;
+  cached[cascade].movableCaster = true;
+}
+
+glm::mat4 ShadowCascades::atlasTransform(int cascade) {
+  GLint x{};
+  GLint y{};
+  viewport(cascade, x, y);
+  const float scale{static_cast<float>(mapSize) / static_cast<float>(atlasSize)};
+  glm::mat4 transform{1.f};
+  transform[0][0] = scale * .5f;
+  transform[1][1] = scale * .5f;
+  transform[2][2] = .5f;
+  transform[3] = glm::vec4{
+    (static_cast<float>(x) + static_cast<float>(mapSize) * .5f) / static_cast<float>(atlasSize),
+    (static_cast<float>(y) + static_cast<float>(mapSize) * .5f) / static_cast<float>(atlasSize),
+    .5f,
+    1.f
+  };
+  return transform;
+}
+
+void ShadowCascades::viewport(int cascade, GLint& x, GLint& y) {
+  x = (cascade % 2) * mapSize;
+  y = (cascade / 2) * mapSize;
+}
+
+ShadowAtlas::ShadowAtlas(GLResources& resources) :
+  resources{resources},
+  handle{resources.createTexture()},
+  memory{resources.memory().track(
+    MemoryCategory::RenderTarget,
+    textureMemorySize(GL_DEPTH_COMPONENT24, ShadowCascades::atlasSize, ShadowCascades::atlasSize, 1, 1)
+  )} {
+  glBindTexture(GL_TEXTURE_2D, resources.get(handle));
+  glTexImage2D(
+    GL_TEXTURE_2D,
+    0,
+    GL_DEPTH_COMPONENT24,
+    ShadowCascades::atlasSize,
+    ShadowCascades::atlasSize,
+    0 /*border*/,
+    GL_DEPTH_COMPONENT,
+    GL_UNSIGNED_INT,
+    nullptr
+  );
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  // Linear filtering with comparison gives 2x2 percentage-closer filtering.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  DEBUG_LOG_LINE("Shadow atlas: " << ShadowCascades::atlasSize << 'x' << ShadowCascades::atlasSize);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+  resources.memory().untrack(memory);
+  resources.destroy(handle);
+}
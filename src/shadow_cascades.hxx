@@ -0,0 +1,94 @@
+#ifndef SHADOW_CASCADES_HXX
+#define SHADOW_CASCADES_HXX
+
+#include <array>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "bounds.hxx"
+#include "camera.hxx"
+#include "gl_resources.hxx"
+#include "render_graph.hxx"
+
+struct ShadowCascade {
+  // Camera-relative position to the cascade's light clip space.
+  glm::mat4 lightProjection;
+  // View depth at which the next cascade takes over.
+  float splitDepth;
+  // Whether the cascade's region of the atlas must be drawn this frame.
+  bool render;
+};
+
+// Cascaded shadow maps for one directional light. The view frustum is split
+// into depth slices and each gets an orthographic light projection around
+// the slice's bounding sphere. The sphere does not change size as the camera
+// turns, and its center is snapped to whole shadow map texels in world
+// space, so shadow edges stay still under camera motion.
+//
+// Near cascades are drawn every frame. Distant cascades, holding only
+// static casters, are fitted with a margin and kept until the slice leaves
+// the cached region, the light turns, or a movable caster enters them.
+class ShadowCascades {
+public:
+  static constexpr int cascadeCount{4};
+  static constexpr int firstCachedCascade{2};
+  // Per cascade; the atlas holds the cascades in a 2x2 grid.
+  static constexpr GLsizei mapSize{1024};
+  static constexpr GLsizei atlasSize{mapSize * 2};
+  // View depth covered by shadows.
+  static constexpr float shadowDistance{400.f};
+  // Blend between logarithmic (1) and uniform (0) splits.
+  static constexpr float splitLambda{.8f};
+  // Extra radius around cached cascades, as a fraction of the slice radius.
+  static constexpr float cacheMargin{.25f};
+
+  // lightDirection points towards the light, in world space.
+  void update(const Camera& camera, float aspectRatio, const glm::dvec3& lightDirection);
+  // Forgets every cached cascade, for when a frame was never rendered.
+  void invalidate();
+  bool overlaps(int cascade, const BoundingBox& relativeBounds) const;
+  // A movable caster keeps a cached cascade drawn this frame and the next,
+  // so that it also disappears from the cascade after leaving.
+  void markMovableCaster(int cascade);
+
+  const ShadowCascade& cascade(int cascade) const { return cascades[cascade]; }
+  // Maps the cascade's light clip space to its quarter of the atlas.
+  static glm::mat4 atlasTransform(int cascade);
+  static void viewport(int cascade, GLint& x, GLint& y);
+
+private:
+  struct CachedRegion {
+    // Light space, snapped.
+    glm::dvec3 center;
+    double extent;
+    bool valid;
+    bool movableCaster;
+  };
+
+  std::array<ShadowCascade, cascadeCount> cascades{};
+  std::array<CachedRegion, cascadeCount> cached{};
+  glm::dvec3 cachedLightDirection{};
+};
+
+// Depth texture holding all cascades, with hardware depth comparison for
+// sampler2DShadow. It outlives frames, so the render graph imports it.
+class ShadowAtlas {
+public:
+  explicit ShadowAtlas(GLResources& resources);
+  ShadowAtlas(const ShadowAtlas&) = delete;
+  ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+  ~ShadowAtlas();
+
+  TextureHandle texture() const { return handle; }
+  RenderTargetDesc desc() const {
+    return RenderTargetDesc{GL_DEPTH_COMPONENT24, ShadowCascades::atlasSize, ShadowCascades::atlasSize};
+  }
+
+private:
+  GLResources& resources;
+  TextureHandle handle;
+  GpuMemoryBudget::Allocation memory;
+};
+
+#endif // SHADOW_CASCADES_HXX
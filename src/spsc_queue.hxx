@@ -0,0 +1,44 @@
+#ifndef SPSC_QUEUE_HXX
+#define SPSC_QUEUE_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Storage is inline, so pushing and popping never allocate.
+template <typename T, std::size_t capacity>
+class SpscQueue {
+public:
+  static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "Queue capacity must be a power of two");
+
+  // Returns false, dropping the value, when the queue is full.
+  bool push(const T& value) {
+    const std::size_t write{writeIndex.load(std::memory_order_relaxed)};
+    if (write - readIndex.load(std::memory_order_acquire) == capacity) {
+      return false;
+    }
+    items[write & (capacity - 1)] = value;
+    writeIndex.store(write + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false when the queue is empty.
+  bool pop(T& value) {
+    const std::size_t read{readIndex.load(std::memory_order_relaxed)};
+    if (read == writeIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = items[read & (capacity - 1)];
+    readIndex.store(read + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  // Separate cache lines, so the two threads do not false-share.
+  alignas(64) std::atomic<std::size_t> readIndex{};
+  alignas(64) std::atomic<std::size_t> writeIndex{};
+  std::array<T, capacity> items{};
+};
+
+#endif // SPSC_QUEUE_HXX
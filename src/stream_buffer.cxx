@@ -0,0 +1,93 @@
+#include "stream_buffer.hxx"
+
+#include "debug.hxx"
+
+namespace {
+
+// Mapping goes through the copy-write binding so it never disturbs VAO or
+// indexed uniform-buffer state bound to the buffer's real target.
+constexpr GLenum mapTarget{GL_COPY_WRITE_BUFFER};
+constexpr GLuint64 fenceTimeout{1'000'000'000};
+
+GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+StreamBuffer::StreamBuffer(GLResources& resources, GLenum target, GLsizeiptr regionSize) :
+  resources{resources},
+  handle{resources.createBuffer()},
+  memory{resources.memory().track(MemoryCategory::Stream, static_cast<std::uint64_t>(regionSize) * framesInFlight)},
+  bufferTarget{target},
+  regionSize{regionSize} {
+  const GLsizeiptr totalSize{regionSize * framesInFlight};
+  glBindBuffer(mapTarget, buffer());
+  if (GLAD_GL_ARB_buffer_storage) {
+    constexpr GLbitfield flags{GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+    glBufferStorage(mapTarget, totalSize, nullptr, flags);
+    persistentMapping = static_cast<std::byte*>(glMapBufferRange(mapTarget, 0, totalSize, flags));
+  } else {
+    glBufferData(mapTarget, totalSize, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(mapTarget, 0);
+  DEBUG_LOG_LINE("Stream buffer: " << (persistent() ? "persistent" : "unsynchronized") << " mapping");
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  resources.memory().untrack(memory);
+  resources.destroy(handle);
+}
+
+void StreamBuffer::beginFrame() {
+  region = (region + 1) % framesInFlight;
+  used = 0;
+  GLsync& fence{fences[region]};
+  if (fence) {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (persistentMapping) {
+    frameMapping = persistentMapping + regionSize * region;
+    return;
+  }
+  // The fence above already guarantees the GPU is done with this region.
+  constexpr GLbitfield flags{
+    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+  };
+  glBindBuffer(mapTarget, buffer());
+  frameMapping = static_cast<std::byte*>(glMapBufferRange(mapTarget, regionSize * region, regionSize, flags));
+  glBindBuffer(mapTarget, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+  const GLsizeiptr start{alignUp(used, alignment)};
+  if (!frameMapping || start + size > regionSize) {
+    DEBUG_ERROR_LINE("Stream buffer: region of " << regionSize << " bytes exhausted");
+    return Allocation{nullptr, 0, 0};
+  }
+  used = start + size;
+  return Allocation{frameMapping + start, regionSize * region + start, size};
+}
+
+void StreamBuffer::commit() {
+  if (persistentMapping || !frameMapping) {
+    return;
+  }
+  glBindBuffer(mapTarget, buffer());
+  glFlushMappedBufferRange(mapTarget, 0, used);
+  glUnmapBuffer(mapTarget);
+  glBindBuffer(mapTarget, 0);
+  frameMapping = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+  commit();
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
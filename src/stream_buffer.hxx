@@ -0,0 +1,62 @@
+#ifndef STREAM_BUFFER_HXX
+#define STREAM_BUFFER_HXX
+
+#include <array>
+#include <cstddef>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+
+// Ring buffer for data that is rewritten every frame: dynamic vertices,
+// indices and uniform blocks. The buffer is split into one region per frame
+// in flight, and each region is guarded by a fence, so writing never makes
+// the driver orphan storage or synchronize implicitly.
+//
+// With ARB_buffer_storage the whole buffer stays persistently and coherently
+// mapped. Otherwise each frame's region is mapped with
+// GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT and must be
+// committed before any draw reads from it.
+class StreamBuffer {
+public:
+  static constexpr int framesInFlight{3};
+
+  struct Allocation {
+    void* data;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+
+  StreamBuffer(GLResources& resources, GLenum target, GLsizeiptr regionSize);
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+  ~StreamBuffer();
+
+  // Moves to the next region, waiting for the GPU only if it is more than
+  // framesInFlight frames behind.
+  void beginFrame();
+  // Returns a null allocation when the region is full.
+  Allocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+  // Makes this frame's writes visible to GL. Call after the last allocate()
+  // and before the first draw that sources the buffer.
+  void commit();
+  void endFrame();
+
+  GLuint buffer() const { return resources.get(handle); }
+  GLenum target() const { return bufferTarget; }
+  bool persistent() const { return persistentMapping != nullptr; }
+
+private:
+  GLResources& resources;
+  BufferHandle handle;
+  GpuMemoryBudget::Allocation memory;
+  GLenum bufferTarget;
+  GLsizeiptr regionSize;
+  int region{framesInFlight - 1};
+  GLsizeiptr used{};
+  std::byte* persistentMapping{};
+  std::byte* frameMapping{};
+  std::array<GLsync, framesInFlight> fences{};
+};
+
+#endif // STREAM_BUFFER_HXX
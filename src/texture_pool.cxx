@@ -0,0 +1,126 @@
+#include "texture_pool.hxx"
+
+#include <algorithm>
+
+#include "debug.hxx"
+
+namespace {
+
+GLsizei clampLayerCount(GLsizei layers) {
+  GLint maxLayers{};
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  return std::max(1, std::min(layers, maxLayers));
+}
+
+} // namespace
+
+TexturePool::TexturePool(GLResources& resources, GLsizei layersPerArray) :
+  resources{resources},
+  layersPerArray{clampLayerCount(layersPerArray)} {}
+
+TextureLayer TexturePool::allocate(const TextureFormat& format) {
+  for (std::size_t i{}; i < arrays.size(); ++i) {
+    TextureArray& array{arrays[i]};
+    if (array.format == format && !array.freeLayers.empty()) {
+      const std::uint32_t layer{array.freeLayers.back()};
+      array.freeLayers.pop_back();
+      return TextureLayer{static_cast<std::uint32_t>(i), layer};
+    }
+  }
+  const std::uint64_t size{
+    textureMemorySize(format.internalFormat, format.width, format.height, layersPerArray, format.levels)
+  };
+  TextureArray array{
+    format,
+    resources.createTexture(),
+    resources.memory().track(MemoryCategory::Texture, size),
+    {},
+    false
+  };
+  // Hand out low layers first.
+  for (GLsizei layer{layersPerArray}; layer > 0; --layer) {
+    array.freeLayers.push_back(static_cast<std::uint32_t>(layer - 1));
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, resources.get(array.texture));
+  GLsizei width{format.width};
+  GLsizei height{format.height};
+  for (GLint level{}; level < format.levels; ++level) {
+    // The pixel format only matters for the data, and there is none yet.
+    glTexImage3D(
+      GL_TEXTURE_2D_ARRAY,
+      level,
+      static_cast<GLint>(format.internalFormat),
+      width,
+      height,
+      layersPerArray,
+      0 /*border*/,
+      GL_RGBA,
+      GL_UNSIGNED_BYTE,
+      nullptr
+    );
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, format.levels - 1);
+  glTexParameteri(
+    GL_TEXTURE_2D_ARRAY,
+    GL_TEXTURE_MIN_FILTER,
+    format.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR
+  );
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  const std::uint32_t layer{array.freeLayers.back()};
+  array.freeLayers.pop_back();
+  arrays.push_back(std::move(array));
+  DEBUG_LOG_LINE(
+    "Texture pool: array " << arrays.size() - 1 << " created with " << layersPerArray
+    << " layers of " << format.width << 'x' << format.height
+  );
+  return TextureLayer{static_cast<std::uint32_t>(arrays.size() - 1), layer};
+}
+
+void TexturePool::free(const TextureLayer& layer) {
+  arrays[layer.array].freeLayers.push_back(layer.layer);
+}
+
+void TexturePool::upload(const TextureLayer& layer, GLenum format, GLenum type, const void* pixels) {
+  TextureArray& array{arrays[layer.array]};
+  glBindTexture(GL_TEXTURE_2D_ARRAY, resources.get(array.texture));
+  glTexSubImage3D(
+    GL_TEXTURE_2D_ARRAY,
+    0 /*level*/,
+    0,
+    0,
+    static_cast<GLint>(layer.layer),
+    array.format.width,
+    array.format.height,
+    1,
+    format,
+    type,
+    pixels
+  );
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  array.mipmapsDirty = array.format.levels > 1;
+}
+
+void TexturePool::generateMipmaps() {
+  for (TextureArray& array : arrays) {
+    if (!array.mipmapsDirty) {
+      continue;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, resources.get(array.texture));
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    array.mipmapsDirty = false;
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TexturePool::destroy() {
+  for (const TextureArray& array : arrays) {
+    resources.memory().untrack(array.memory);
+    resources.destroy(array.texture);
+  }
+  arrays.clear();
+}
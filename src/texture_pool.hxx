@@ -0,0 +1,64 @@
+#ifndef TEXTURE_POOL_HXX
+#define TEXTURE_POOL_HXX
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+
+#include "gl_resources.hxx"
+
+struct TextureFormat {
+  GLenum internalFormat;
+  GLsizei width;
+  GLsizei height;
+  GLsizei levels;
+
+  bool operator==(const TextureFormat& other) const {
+    return internalFormat == other.internalFormat && width == other.width && height == other.height
+      && levels == other.levels;
+  }
+};
+
+struct TextureLayer {
+  std::uint32_t array;
+  std::uint32_t layer;
+};
+
+// Packs color textures of the same format and size into the layers of
+// GL_TEXTURE_2D_ARRAY objects. Materials refer to a layer rather than a
+// texture, so draws whose materials only differ in their textures still
+// share one binding and can be merged. A full array is never resized;
+// another array of the same format is created next to it instead.
+class TexturePool {
+public:
+  explicit TexturePool(GLResources& resources, GLsizei layersPerArray = 64);
+  TexturePool(const TexturePool&) = delete;
+  TexturePool& operator=(const TexturePool&) = delete;
+
+  TextureLayer allocate(const TextureFormat& format);
+  void free(const TextureLayer& layer);
+  // Uploads the base level. Lower levels are rebuilt by generateMipmaps().
+  void upload(const TextureLayer& layer, GLenum format, GLenum type, const void* pixels);
+  // Rebuilds the mipmaps of every array uploaded to since the last call.
+  void generateMipmaps();
+  // Destroys every array. Needs a current context, like GLResources.
+  void destroy();
+
+  TextureHandle texture(std::uint32_t array) const { return arrays[array].texture; }
+
+private:
+  struct TextureArray {
+    TextureFormat format;
+    TextureHandle texture;
+    GpuMemoryBudget::Allocation memory;
+    std::vector<std::uint32_t> freeLayers;
+    bool mipmapsDirty;
+  };
+
+  GLResources& resources;
+  GLsizei layersPerArray;
+  std::vector<TextureArray> arrays{};
+};
+
+#endif // TEXTURE_POOL_HXX
@@ -0,0 +1,136 @@
+#include "vertex_format.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+struct EncodingInfo {
+  GLint components;
+  GLenum type;
+  GLboolean normalized;
+  std::uint32_t size;
+};
+
+EncodingInfo encodingInfo(AttributeEncoding encoding) {
+  switch (encoding) {
+    case AttributeEncoding::Float32x2:
+      return EncodingInfo{2, GL_FLOAT, GL_FALSE, 8};
+    case AttributeEncoding::Float32x4:
+      return EncodingInfo{4, GL_FLOAT, GL_FALSE, 16};
+    case AttributeEncoding::Unorm16x4:
+      return EncodingInfo{4, GL_UNSIGNED_SHORT, GL_TRUE, 8};
+    case AttributeEncoding::Float16x2:
+      return EncodingInfo{2, GL_HALF_FLOAT, GL_FALSE, 4};
+    case AttributeEncoding::Snorm16x2Octahedral:
+      return EncodingInfo{2, GL_SHORT, GL_TRUE, 4};
+    case AttributeEncoding::Unorm10x3_2:
+      return EncodingInfo{4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE, 4};
+  }
+  return EncodingInfo{};
+}
+
+std::int16_t toSnorm16(float value) {
+  return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+float fromSnorm16(std::int16_t value) {
+  return std::max(static_cast<float>(value) / 32767.f, -1.f);
+}
+
+} // namespace
+
+std::uint32_t encodingSize(AttributeEncoding encoding) {
+  return encodingInfo(encoding).size;
+}
+
+VertexFormat makeVertexFormat(const std::vector<std::pair<VertexAttribute, AttributeEncoding>>& attributes) {
+  VertexFormat format{};
+  for (const auto& [attribute, encoding] : attributes) {
+    format.attributes.push_back(AttributeLayout{attribute, encoding, format.stride});
+    format.stride += (encodingSize(encoding) + 3) & ~3u;
+  }
+  return format;
+}
+
+void applyVertexFormat(const VertexFormat& format, GLintptr baseOffset) {
+  for (const AttributeLayout& layout : format.attributes) {
+    const EncodingInfo info{encodingInfo(layout.encoding)};
+    const GLuint location{static_cast<GLuint>(layout.attribute)};
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(
+      location,
+      info.components,
+      info.type,
+      info.normalized,
+      static_cast<GLsizei>(format.stride),
+      reinterpret_cast<const void*>(baseOffset + layout.offset)
+    );
+  }
+}
+
+std::uint16_t encodeHalf(float value) {
+  std::uint32_t bits{};
+  std::memcpy(&bits, &value, sizeof(bits));
+  const std::uint32_t sign{(bits >> 16) & 0x8000u};
+  const std::int32_t exponent{static_cast<std::int32_t>((bits >> 23) & 0xffu) - 127 + 15};
+  std::uint32_t mantissa{bits & 0x7fffffu};
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<std::uint16_t>(sign);
+    }
+    // Subnormal half.
+    mantissa |= 0x800000u;
+    const std::uint32_t shift{static_cast<std::uint32_t>(14 - exponent)};
+    std::uint32_t half{mantissa >> shift};
+    if ((mantissa >> (shift - 1)) & 1u) {
+      ++half;
+    }
+    return static_cast<std::uint16_t>(sign | half);
+  }
+  if (exponent >= 31) {
+    // Overflow saturates to infinity; NaN keeps a payload bit.
+    const bool isNaN{((bits >> 23) & 0xffu) == 0xffu && mantissa != 0};
+    return static_cast<std::uint16_t>(sign | 0x7c00u | (isNaN ? 0x200u : 0u));
+  }
+  std::uint32_t half{sign | (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13)};
+  // Round to nearest; a carry into the exponent is still correct.
+  if (mantissa & 0x1000u) {
+    ++half;
+  }
+  return static_cast<std::uint16_t>(half);
+}
+
+std::uint32_t encodeOctahedral(const glm::vec3& unitVector) {
+  const float l1Norm{std::abs(unitVector.x) + std::abs(unitVector.y) + std::abs(unitVector.z)};
+  float x{unitVector.x / l1Norm};
+  float y{unitVector.y / l1Norm};
+  if (unitVector.z < 0.f) {
+    const float foldedX{(1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f)};
+    const float foldedY{(1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f)};
+    x = foldedX;
+    y = foldedY;
+  }
+  return static_cast<std::uint16_t>(toSnorm16(x)) | (static_cast<std::uint32_t>(static_cast<std::uint16_t>(toSnorm16(y))) << 16);
+}
+
+glm::vec3 decodeOctahedral(std::uint32_t encoded) {
+  const float x{fromSnorm16(static_cast<std::int16_t>(encoded & 0xffffu))};
+  const float y{fromSnorm16(static_cast<std::int16_t>(encoded >> 16))};
+  glm::vec3 vector{x, y, 1.f - std::abs(x) - std::abs(y)};
+  const float fold{std::max(-vector.z, 0.f)};
+  vector.x += vector.x >= 0.f ? -fold : fold;
+  vector.y += vector.y >= 0.f ? -fold : fold;
+  return glm::normalize(vector);
+}
+
+std::uint32_t encodeUnorm10x3_2(const glm::vec4& value) {
+  const auto quantize{[](float component, float maximum) {
+    return static_cast<std::uint32_t>(std::lround(std::clamp(component, 0.f, 1.f) * maximum));
+  }};
+  return quantize(value.x, 1023.f)
+    | (quantize(value.y, 1023.f) << 10)
+    | (quantize(value.z, 1023.f) << 20)
+    | (quantize(value.w, 3.f) << 30);
+}
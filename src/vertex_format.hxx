@@ -0,0 +1,65 @@
+#ifndef VERTEX_FORMAT_HXX
+#define VERTEX_FORMAT_HXX
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+// Shader input locations shared by every mesh shader.
+enum class VertexAttribute : GLuint {
+  Position = 0,
+  Normal = 1,
+  Tangent = 2,
+  TexCoord = 3,
+  Color = 4,
+};
+
+enum class AttributeEncoding : std::uint8_t {
+  Float32x2,
+  Float32x4,
+  // Normalized to the mesh bounds; the shader rescales with the per-mesh
+  // positionScale and positionOffset.
+  Unorm16x4,
+  Float16x2,
+  // Octahedral unit vector in two signed normalized 16-bit components.
+  Snorm16x2Octahedral,
+  // GL_UNSIGNED_INT_2_10_10_10_REV.
+  Unorm10x3_2,
+};
+
+struct AttributeLayout {
+  VertexAttribute attribute;
+  AttributeEncoding encoding;
+  std::uint32_t offset;
+
+  bool operator==(const AttributeLayout& other) const {
+    return attribute == other.attribute && encoding == other.encoding && offset == other.offset;
+  }
+};
+
+struct VertexFormat {
+  std::vector<AttributeLayout> attributes{};
+  std::uint32_t stride{};
+
+  bool operator==(const VertexFormat& other) const {
+    return stride == other.stride && attributes == other.attributes;
+  }
+  bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+};
+
+std::uint32_t encodingSize(AttributeEncoding encoding);
+// Packs the attributes in order, keeping every offset 4-byte aligned.
+VertexFormat makeVertexFormat(const std::vector<std::pair<VertexAttribute, AttributeEncoding>>& attributes);
+// Describes the format to the bound VAO, sourcing from the bound
+// GL_ARRAY_BUFFER starting at baseOffset.
+void applyVertexFormat(const VertexFormat& format, GLintptr baseOffset = 0);
+
+std::uint16_t encodeHalf(float value);
+std::uint32_t encodeOctahedral(const glm::vec3& unitVector);
+glm::vec3 decodeOctahedral(std::uint32_t encoded);
+std::uint32_t encodeUnorm10x3_2(const glm::vec4& value);
+
+#endif // VERTEX_FORMAT_HXX